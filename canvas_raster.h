@@ -0,0 +1,384 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Anti-aliased drawing straight into an RGB565 pixel buffer, for the
+// shapes the plot is made of: thick polylines and filled discs.
+//
+// Both are drawn as capsules, the points within a radius of a segment (a
+// disc is a capsule of zero length). Each pixel row of a capsule is one
+// interval, found in closed form. Its inner part is fully covered and is
+// filled as a plain span; only the few pixels at either end have their
+// coverage taken from the distance to the segment and are blended. Pixel
+// centres are at integer coordinates, as for lv_point_t.
+//
+// Discs up to kMaxStampRadius are the exception: the coverage of the last
+// one is kept as a stamp, so the thousands of equal dots of a scatter plot
+// are copies of one table with no distance computations.
+//
+// Views of dense data come down to solid rectangles and single blended
+// pixels, which are plain fills. Translucent bands are filled row by row
+// as horizontal spans, found from their outline alone.
+//
+// Colors are plain RGB565 (not byte-swapped). Nothing is allocated after
+// setBuffer().
+class CanvasRaster {
+public:
+    // Largest disc radius drawn from a stamp, in pixels
+    static const int kMaxStampRadius = 8;
+    
+    CanvasRaster() : pixels_(nullptr), width_(0), height_(0),
+                     clip_x0_(0), clip_y0_(0), clip_x1_(-1), clip_y1_(-1) {
+        stamp_.radius = 0.0f;
+    }
+    
+    // Draw into a width x height buffer, rows back to back. Resets the
+    // clip rectangle to the whole buffer.
+    void setBuffer(uint16_t* pixels, int width, int height) {
+        pixels_ = pixels;
+        width_ = width;
+        height_ = height;
+        run_starts_.assign(std::max(height, 0), 0);
+        setClip(0, 0, width - 1, height - 1);
+    }
+    
+    // Limit drawing to pixels x0..x1, y0..y1 (inclusive) of the buffer
+    void setClip(int x0, int y0, int x1, int y1) {
+        clip_x0_ = std::max(x0, 0);
+        clip_y0_ = std::max(y0, 0);
+        clip_x1_ = std::min(x1, width_ - 1);
+        clip_y1_ = std::min(y1, height_ - 1);
+    }
+    
+    void fillDisc(float cx, float cy, float radius, uint16_t color) {
+        if (!pixels_ || !(radius > 0.0f)) return;
+        if (radius > kMaxStampRadius) {
+            fillCapsule(cx, cy, cx, cy, radius, color);
+            return;
+        }
+        
+        // The stamp depends only on the radius and the position within a
+        // pixel
+        int origin_x = (int)std::floor(cx);
+        int origin_y = (int)std::floor(cy);
+        float fx = cx - origin_x;
+        float fy = cy - origin_y;
+        if (radius != stamp_.radius || fx != stamp_.fx || fy != stamp_.fy) {
+            buildStamp(radius, fx, fy);
+        }
+        
+        int left = origin_x - stamp_.reach;
+        int top = origin_y - stamp_.reach;
+        int j0 = std::max(0, clip_y0_ - top);
+        int j1 = std::min(stamp_.size - 1, clip_y1_ - top);
+        int i_min = std::max(0, clip_x0_ - left);
+        int i_max = std::min(stamp_.size - 1, clip_x1_ - left);
+        for (int j = j0; j <= j1; j++) {
+            const uint8_t* alpha = stamp_.alpha + j * kStampSize;
+            uint16_t* row = pixels_ + (top + j) * width_ + left;
+            int solid_i0 = std::max(i_min, (int)stamp_.solid_start[j]);
+            int solid_i1 = std::min(i_max, (int)stamp_.solid_end[j] - 1);
+            if (solid_i0 > solid_i1) {
+                solid_i0 = i_max + 1;
+                solid_i1 = i_max;
+            }
+            for (int i = i_min; i < solid_i0; i++) {
+                if (alpha[i]) row[i] = blend(row[i], color, alpha[i]);
+            }
+            std::fill(row + solid_i0, row + solid_i1 + 1, color);
+            for (int i = solid_i1 + 1; i <= i_max; i++) {
+                if (alpha[i]) row[i] = blend(row[i], color, alpha[i]);
+            }
+        }
+    }
+    
+    // A line of the given width with round ends
+    void drawLine(float ax, float ay, float bx, float by, float width, uint16_t color) {
+        fillCapsule(ax, ay, bx, by, 0.5f * width, color);
+    }
+    
+    // Consecutive points joined by lines of the given width. PointT is any
+    // struct with x and y members, such as lv_point_t. Round ends make the
+    // joins round as well.
+    template<typename PointT>
+    void drawPolyline(const PointT* points, int count, float width, uint16_t color) {
+        for (int i = 0; i + 1 < count; i++) {
+            fillCapsule(points[i].x, points[i].y, points[i + 1].x, points[i + 1].y,
+                        0.5f * width, color);
+        }
+    }
+    
+    // Pixels x0..x1, y0..y1 (inclusive, any order), not anti-aliased
+    void fillRect(int x0, int y0, int x1, int y1, uint16_t color) {
+        if (!pixels_) return;
+        if (x0 > x1) std::swap(x0, x1);
+        if (y0 > y1) std::swap(y0, y1);
+        x0 = std::max(x0, clip_x0_);
+        y0 = std::max(y0, clip_y0_);
+        x1 = std::min(x1, clip_x1_);
+        y1 = std::min(y1, clip_y1_);
+        for (int y = y0; y <= y1; y++) {
+            uint16_t* row = pixels_ + y * width_;
+            std::fill(row + x0, row + x1 + 1, color);
+        }
+    }
+    
+    // One pixel, blended over with alpha in 0..32
+    void fillPixel(int x, int y, uint16_t color, uint32_t alpha) {
+        if (!pixels_ || x < clip_x0_ || x > clip_x1_ || y < clip_y0_ || y > clip_y1_) return;
+        uint16_t* pixel = pixels_ + y * width_ + x;
+        *pixel = blend(*pixel, color, alpha);
+    }
+    
+    // The region between rows top[c] and bottom[c] (inclusive) of columns
+    // left + c for c = 0..count-1, blended over with alpha in 0..32.
+    // Columns with top[c] > bottom[c] are empty. Walking the columns, the
+    // rows a column gains over the one before open a span and the rows it
+    // loses close one, which is then blended in one go along its row. The
+    // cost is the pixels covered plus the length of the outline.
+    void fillBand(int left, const int16_t* top, const int16_t* bottom, int count,
+                  uint16_t color, uint32_t alpha) {
+        if (!pixels_ || alpha == 0) return;
+        int open_top = 0;
+        int open_bottom = -1;
+        for (int c = 0; c <= count; c++) {
+            int x = left + c;
+            int y0 = 0;
+            int y1 = -1;
+            if (c < count && x >= clip_x0_ && x <= clip_x1_) {
+                y0 = std::max((int)top[c], clip_y0_);
+                y1 = std::min((int)bottom[c], clip_y1_);
+                if (y0 > y1) {
+                    y0 = 0;
+                    y1 = -1;
+                }
+            }
+            
+            // Rows left above and below this column's, then rows gained
+            for (int y = open_top; y <= std::min(open_bottom, y0 - 1); y++) {
+                blendSpan(y, run_starts_[y], x - 1, color, alpha);
+            }
+            for (int y = std::max(open_top, y1 + 1); y <= open_bottom; y++) {
+                blendSpan(y, run_starts_[y], x - 1, color, alpha);
+            }
+            for (int y = y0; y <= std::min(y1, open_top - 1); y++) {
+                run_starts_[y] = (int16_t)x;
+            }
+            for (int y = std::max(y0, open_bottom + 1); y <= y1; y++) {
+                run_starts_[y] = (int16_t)x;
+            }
+            open_top = y0;
+            open_bottom = y1;
+        }
+    }
+    
+    // src over dst with alpha in 0..32. The channels are spread over a
+    // 32-bit word with gaps wide enough that one multiply blends all three.
+    static uint16_t blend(uint16_t dst, uint16_t src, uint32_t alpha) {
+        uint32_t s = (src | (uint32_t(src) << 16)) & kSpreadMask;
+        uint32_t d = (dst | (uint32_t(dst) << 16)) & kSpreadMask;
+        uint32_t mixed = (d + (((s - d) * alpha) >> 5)) & kSpreadMask;
+        return (uint16_t)(mixed | (mixed >> 16));
+    }
+
+private:
+    // Green moved to the upper half, red and blue left in place
+    static const uint32_t kSpreadMask = 0x07E0F81F;
+    
+    // A stamp reaches ceil(radius + 0.5) pixels out from the centre pixel,
+    // plus one pixel for the offset within it
+    static const int kStampSize = 2 * (kMaxStampRadius + 1) + 2;
+    
+    // Coverage of a disc around (fx, fy) of pixel (reach, reach), as blend
+    // alphas, with each row's fully covered run [solid_start, solid_end)
+    struct DiscStamp {
+        float radius;
+        float fx, fy;
+        int reach;
+        int size;
+        uint8_t alpha[kStampSize * kStampSize];
+        int8_t solid_start[kStampSize];
+        int8_t solid_end[kStampSize];
+    };
+    
+    void buildStamp(float radius, float fx, float fy) {
+        stamp_.radius = radius;
+        stamp_.fx = fx;
+        stamp_.fy = fy;
+        stamp_.reach = (int)std::ceil(radius + 0.5f);
+        stamp_.size = 2 * stamp_.reach + 2;
+        float cx = stamp_.reach + fx;
+        float cy = stamp_.reach + fy;
+        for (int j = 0; j < stamp_.size; j++) {
+            stamp_.solid_start[j] = 0;
+            stamp_.solid_end[j] = 0;
+            for (int i = 0; i < stamp_.size; i++) {
+                float coverage = radius + 0.5f - std::hypot(i - cx, j - cy);
+                uint32_t alpha = coverage <= 0.0f ? 0 :
+                                 coverage >= 1.0f ? 32 : (uint32_t)(coverage * 32.0f + 0.5f);
+                stamp_.alpha[j * kStampSize + i] = (uint8_t)alpha;
+                if (alpha == 32) {
+                    if (stamp_.solid_end[j] == 0) stamp_.solid_start[j] = (int8_t)i;
+                    stamp_.solid_end[j] = (int8_t)(i + 1);
+                }
+            }
+        }
+    }
+    
+    void blendSpan(int y, int x0, int x1, uint16_t color, uint32_t alpha) {
+        uint16_t* row = pixels_ + y * width_;
+        if (alpha >= 32) {
+            std::fill(row + x0, row + x1 + 1, color);
+            return;
+        }
+        for (int x = x0; x <= x1; x++) {
+            row[x] = blend(row[x], color, alpha);
+        }
+    }
+    
+    // Segment from a to b with its unit direction, set up once per shape
+    struct Segment {
+        float ax, ay, bx, by;
+        float dx, dy;
+        float length;
+        float inv_length_sq;
+        float ux, uy;
+    };
+    
+    void fillCapsule(float ax, float ay, float bx, float by, float radius, uint16_t color) {
+        if (!pixels_ || !(radius > 0.0f)) return;
+        
+        Segment segment;
+        segment.ax = ax;
+        segment.ay = ay;
+        segment.bx = bx;
+        segment.by = by;
+        segment.dx = bx - ax;
+        segment.dy = by - ay;
+        float length_sq = segment.dx * segment.dx + segment.dy * segment.dy;
+        segment.length = std::sqrt(length_sq);
+        segment.inv_length_sq = length_sq > 0.0f ? 1.0f / length_sq : 0.0f;
+        segment.ux = length_sq > 0.0f ? segment.dx / segment.length : 0.0f;
+        segment.uy = length_sq > 0.0f ? segment.dy / segment.length : 0.0f;
+        
+        // Pixels within radius - 0.5 of the segment are covered fully and
+        // coverage falls off linearly to zero at radius + 0.5
+        float outer = radius + 0.5f;
+        float inner = radius - 0.5f;
+        int y0 = std::max(clip_y0_, (int)std::ceil(std::min(ay, by) - outer));
+        int y1 = std::min(clip_y1_, (int)std::floor(std::max(ay, by) + outer));
+        
+        for (int y = y0; y <= y1; y++) {
+            float outer_x0, outer_x1;
+            if (!span(segment, outer, (float)y, outer_x0, outer_x1)) continue;
+            int x0 = std::max(clip_x0_, (int)std::ceil(outer_x0));
+            int x1 = std::min(clip_x1_, (int)std::floor(outer_x1));
+            if (x0 > x1) continue;
+            
+            // Fully covered run, filled as a span between the blended ends
+            uint16_t* row = pixels_ + y * width_;
+            float inner_x0, inner_x1;
+            if (inner > 0.0f && span(segment, inner, (float)y, inner_x0, inner_x1)) {
+                int solid_x0 = std::max(x0, (int)std::ceil(inner_x0));
+                int solid_x1 = std::min(x1, (int)std::floor(inner_x1));
+                if (solid_x0 <= solid_x1) {
+                    for (int x = x0; x < solid_x0; x++) {
+                        blendPixel(row + x, x, y, segment, outer, color);
+                    }
+                    std::fill(row + solid_x0, row + solid_x1 + 1, color);
+                    x0 = solid_x1 + 1;
+                }
+            }
+            for (int x = x0; x <= x1; x++) {
+                blendPixel(row + x, x, y, segment, outer, color);
+            }
+        }
+    }
+    
+    // Blend one edge pixel by its coverage, outer minus its distance to
+    // the segment
+    static void blendPixel(uint16_t* pixel, int x, int y, const Segment& segment, float outer,
+                           uint16_t color) {
+        float wx = x - segment.ax;
+        float wy = y - segment.ay;
+        float t = std::min(std::max((wx * segment.dx + wy * segment.dy) * segment.inv_length_sq,
+                                    0.0f), 1.0f);
+        float ex = wx - t * segment.dx;
+        float ey = wy - t * segment.dy;
+        float coverage = outer - std::sqrt(ex * ex + ey * ey);
+        if (coverage <= 0.0f) return;
+        uint32_t alpha = coverage >= 1.0f ? 32 : (uint32_t)(coverage * 32.0f + 0.5f);
+        *pixel = alpha >= 32 ? color : blend(*pixel, color, alpha);
+    }
+    
+    // Interval [x0, x1] of row y within radius of the segment. The capsule
+    // is convex, so this is the hull of the row's intervals through the
+    // two end discs and the band along the segment.
+    static bool span(const Segment& segment, float radius, float y, float& x0, float& x1) {
+        const float infinity = std::numeric_limits<float>::infinity();
+        x0 = infinity;
+        x1 = -infinity;
+        discSpan(segment.ax, segment.ay, radius, y, x0, x1);
+        if (segment.length == 0.0f) return x0 <= x1;
+        discSpan(segment.bx, segment.by, radius, y, x0, x1);
+        
+        float ux = segment.ux;
+        float uy = segment.uy;
+        float ry = y - segment.ay;
+        float lo = -infinity;
+        float hi = infinity;
+        
+        // Projection onto the segment within 0..length
+        if (ux != 0.0f) {
+            float p0 = segment.ax - uy * ry / ux;
+            float p1 = segment.ax + (segment.length - uy * ry) / ux;
+            lo = std::max(lo, std::min(p0, p1));
+            hi = std::min(hi, std::max(p0, p1));
+        } else if (uy * ry < 0.0f || uy * ry > segment.length) {
+            return x0 <= x1;
+        }
+        
+        // Distance from the line within radius
+        if (uy != 0.0f) {
+            float q0 = segment.ax + (ux * ry - radius) / uy;
+            float q1 = segment.ax + (ux * ry + radius) / uy;
+            lo = std::max(lo, std::min(q0, q1));
+            hi = std::min(hi, std::max(q0, q1));
+        } else if (std::fabs(ux * ry) > radius) {
+            return x0 <= x1;
+        }
+        
+        if (lo <= hi) {
+            x0 = std::min(x0, lo);
+            x1 = std::max(x1, hi);
+        }
+        return x0 <= x1;
+    }
+    
+    static void discSpan(float cx, float cy, float radius, float y, float& x0, float& x1) {
+        float h_sq = radius * radius - (y - cy) * (y - cy);
+        if (h_sq < 0.0f) return;
+        float h = std::sqrt(h_sq);
+        x0 = std::min(x0, cx - h);
+        x1 = std::max(x1, cx + h);
+    }
+    
+    uint16_t* pixels_;
+    int width_;
+    int height_;
+    
+    // Clip rectangle, inclusive
+    int clip_x0_;
+    int clip_y0_;
+    int clip_x1_;
+    int clip_y1_;
+    
+    DiscStamp stamp_;
+    
+    // Column where the open span of each row of a band began
+    std::vector<int16_t> run_starts_;
+};
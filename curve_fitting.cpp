@@ -1,27 +1,173 @@
 #include "curve_fitting.h"
 #include <algorithm> // For std::min, std::max
+#include <cmath>     // For std::sqrt, std::isfinite
+#include <cstring>   // For memcpy
+#include <esp_cpu.h> // For esp_cpu_get_cycle_count
+
+// CanvasRaster writes the canvas buffer as plain RGB565
+#if LV_COLOR_DEPTH != 16 || LV_COLOR_16_SWAP
+#error "The canvas needs LV_COLOR_DEPTH 16 with LV_COLOR_16_SWAP off"
+#endif
 
 CurveFittingUI* g_curveFittingUI = nullptr;
 
+namespace {
+
+// Tick label for value, with as many decimals as ticks step apart need.
+// Values that fit in 15 digits are formatted by hand, which is much
+// cheaper than snprintf and rounds the same (the scaled float is exact in
+// a double); the rest go through snprintf.
+void formatTick(char* text, size_t size, float value, float step) {
+    static const double kPowers[] = {1.0, 10.0, 100.0, 1000.0};
+    int decimals = step >= 1.0f ? 0 : std::min(3, (int)std::ceil(-std::log10(step) - 1e-3f));
+    if (std::fabs(value) < 0.5f * step) value = 0.0f;
+    double scaled = std::nearbyint((double)value * kPowers[decimals]);
+    if (!(std::fabs(scaled) < 1e15) || size < 24) {
+        snprintf(text, size, "%.*f", decimals, value);
+        return;
+    }
+    
+    // Digits from the last one back, with the decimal point in between
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    uint64_t magnitude = (uint64_t)std::fabs(scaled);
+    for (int d = 0; d <= decimals || magnitude; d++) {
+        if (d == decimals && decimals > 0) *--p = '.';
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    if (scaled < 0.0) *--p = '-';
+    memcpy(text, p, end - p);
+    text[end - p] = '\0';
+}
+
+// Canvas rows of a band from y - half to y + half, clamped to the plot,
+// or an empty range if it misses the plot
+void bandRows(const PlotMapping& mapping, float y, float half, int16_t& top, int16_t& bottom) {
+    float y0 = mapping.pixelY(y + half);
+    float y1 = mapping.pixelY(y - half);
+    if (y0 > y1) std::swap(y0, y1);
+    if (!(y0 <= mapping.bottom && y1 >= mapping.top)) {
+        top = 1;
+        bottom = 0;
+        return;
+    }
+    top = (int16_t)std::lround(std::max(y0, mapping.top));
+    bottom = (int16_t)std::lround(std::min(y1, mapping.bottom));
+}
+
+// Number of distinct x among count points, up to limit (at most
+// MAX_FIT_DEGREE + 1). Any spread-out data reaches the limit within a
+// few points, so only repeated x values make it read them all.
+template<typename PointT>
+int distinctX(const PointT* points, int count, int limit) {
+    float seen[MAX_FIT_DEGREE + 1];
+    limit = std::min(limit, MAX_FIT_DEGREE + 1);
+    int distinct = 0;
+    for (int i = 0; i < count && distinct < limit; i++) {
+        if (std::find(seen, seen + distinct, points[i].x) == seen + distinct) {
+            seen[distinct++] = points[i].x;
+        }
+    }
+    return distinct;
+}
+
+} // namespace
+
+#if CURVE_FIT_PROFILE
+namespace {
+
+// Cost of each robust fit iteration, measured from the end of the previous
+// one (or the start of the fit)
+struct IterationProfile {
+    uint32_t cycles;
+    unsigned long allocations;
+};
+
+void logRobustIteration(void* context, int iteration, float scale, float change) {
+    IterationProfile* profile = (IterationProfile*)context;
+    uint32_t cycles = esp_cpu_get_cycle_count();
+    unsigned long allocations = Eigen::allocationCount();
+    Serial.printf("irls: iteration %d scale %.4f change %.2e, %lu cycles, %lu allocations\n",
+                  iteration, scale, change, (unsigned long)(cycles - profile->cycles),
+                  allocations - profile->allocations);
+    profile->cycles = cycles;
+    profile->allocations = allocations;
+}
+
+} // namespace
+#endif
+
 CurveFittingUI::CurveFittingUI() : 
     canvas(nullptr), 
     cbuf(nullptr),
+    axis_layer(nullptr),
+    axis_layer_valid(false),
     sidebar(nullptr),
     degree_dropdown(nullptr),
+    method_dropdown(nullptr),
     plot_btn(nullptr),
     clear_btn(nullptr),
     status_label(nullptr),
+    live_checkbox(nullptr),
+    frame_label(nullptr),
+    points_sorted(true),
+    density_valid(false),
+    density_points(0),
+    fit_method(FitMethod::LeastSquares),
     polynomial_degree(2),
+    solver_arena(SOLVER_ARENA_BYTES, SOLVER_MEMORY_TIER),
+    fit_stride(1),
+    fitted_degree(0),
+    cv_rmse(NAN),
+    cv_leave_one_out(false),
+    curve_source(CurveSource::None),
+    curve_x_min(0),
+    curve_x_max(0),
+    band_scale(NAN),
+    fit(nullptr),
+    fit_job(0),
+    shown_job(0),
+    fit_epoch(0),
+    fit_timer(nullptr),
+    fit_progress(-1),
     x_min(0),
     x_max(10),
     y_min(0),
     y_max(10),
-    axis_initialized(false) {
+    axis_initialized(false),
+    gesture(Gesture::None),
+    frame_snapshot(nullptr),
+    settle_timer(nullptr),
+    preview_shown(false),
+    live_fit(false),
+    live_point(0),
+    frame_fit_ms(0),
+    frame_draw_ms(0),
+    frame_period_ms(0),
+    frame_time_us(0) {
     g_curveFittingUI = this;
+    Eigen::setMemoryTier(SOLVER_HEAP_TIER);
+    fit_status[0] = '\0';
+    
+    // 2 MB, which malloc places in PSRAM; reserved up front so a large
+    // capture never needs the old and the grown store at once
+    points.reserve(MAX_POINTS);
+    fit_subset.reserve(MAX_FIT_POINTS);
 }
 
 void CurveFittingUI::init() {
     createUI();
+    
+    // Long fits report how far they are and stop when superseded
+    robust_fit.setProgressCallback(fit_progress_cb, this);
+    ransac_fit.setProgressCallback(fit_progress_cb, this);
+    ransac_fit.setHelperTask(RANSAC_HELPER_CORE, RANSAC_HELPER_PRIORITY);
+    if (!fit_worker.start(fit_job_cb, this, FIT_WORKER_CORE, FIT_WORKER_STACK_SIZE,
+                          FIT_WORKER_PRIORITY)) {
+        Serial.println("Fit worker not started, fitting on the LVGL task");
+    }
 }
 
 void CurveFittingUI::createUI() {
@@ -42,8 +188,24 @@ void CurveFittingUI::createUI() {
         LV_CANVAS_BUF_SIZE_TRUE_COLOR(CANVAS_WIDTH, CANVAS_HEIGHT),
         MALLOC_CAP_SPIRAM
     );
+    axis_layer = (lv_color_t*)heap_caps_malloc(
+        LV_CANVAS_BUF_SIZE_TRUE_COLOR(CANVAS_WIDTH, CANVAS_HEIGHT),
+        MALLOC_CAP_SPIRAM
+    );
+    frame_snapshot = (lv_color_t*)heap_caps_malloc(
+        LV_CANVAS_BUF_SIZE_TRUE_COLOR(CANVAS_WIDTH, CANVAS_HEIGHT),
+        MALLOC_CAP_SPIRAM
+    );
     canvas = lv_canvas_create(screen);
     lv_canvas_set_buffer(canvas, cbuf, CANVAS_WIDTH, CANVAS_HEIGHT, LV_IMG_CF_TRUE_COLOR);
+    raster.setBuffer(&cbuf->full, CANVAS_WIDTH, CANVAS_HEIGHT);
+    buildGlyphAtlas();
+    
+    // Points outside the viewport may overlap the axis by their radius,
+    // no more
+    PlotMapping plot = plotMapping();
+    raster.setClip(plot.left - POINT_RADIUS, plot.top - POINT_RADIUS,
+                   plot.right + POINT_RADIUS, plot.bottom + POINT_RADIUS);
     lv_obj_align(canvas, LV_ALIGN_LEFT_MID, 10, 0);
     
     // Set canvas background and style
@@ -56,10 +218,27 @@ void CurveFittingUI::createUI() {
     
     // Drawing the initial axis
     drawAxis();
+    flushDirtyTiles();
     
     // Add event for canvas touch
     lv_obj_add_flag(canvas, LV_OBJ_FLAG_CLICKABLE);
     lv_obj_add_event_cb(canvas, canvas_event_cb, LV_EVENT_PRESSED, NULL);
+    lv_obj_add_event_cb(canvas, canvas_event_cb, LV_EVENT_PRESSING, NULL);
+    lv_obj_add_event_cb(canvas, canvas_event_cb, LV_EVENT_RELEASED, NULL);
+    lv_obj_add_event_cb(canvas, canvas_event_cb, LV_EVENT_PRESS_LOST, NULL);
+    settle_timer = lv_timer_create(settle_timer_cb, GESTURE_SETTLE_MS, this);
+    fit_timer = lv_timer_create(fit_timer_cb, FIT_POLL_MS, this);
+    lv_timer_pause(settle_timer);
+    
+    // Frame time readout over the top right of the plot, shown in live
+    // fit mode
+    frame_label = lv_label_create(screen);
+    lv_label_set_text(frame_label, "");
+    lv_obj_set_width(frame_label, 260);
+    lv_obj_set_style_text_align(frame_label, LV_TEXT_ALIGN_RIGHT, 0);
+    lv_obj_set_style_text_color(frame_label, lv_color_hex(TEXT_COLOR), 0);
+    lv_obj_align_to(frame_label, canvas, LV_ALIGN_TOP_RIGHT, -30, 6);
+    lv_obj_add_flag(frame_label, LV_OBJ_FLAG_HIDDEN);
     
     // Create sidebar on the right
     sidebar = lv_obj_create(screen);
@@ -85,7 +264,25 @@ void CurveFittingUI::createUI() {
                            "Quadratic (degree 2)\n"
                            "Cubic (degree 3)\n"
                            "Quartic (degree 4)\n"
-                           "Quintic (degree 5)");
+                           "Quintic (degree 5)\n"
+                           "Degree 6\n"
+                           "Degree 7\n"
+                           "Degree 8\n"
+                           "Degree 9\n"
+                           "Degree 10\n"
+                           "Degree 11\n"
+                           "Degree 12\n"
+                           "Degree 13\n"
+                           "Degree 14\n"
+                           "Degree 15\n"
+                           "Degree 16\n"
+                           "Degree 17\n"
+                           "Degree 18\n"
+                           "Degree 19\n"
+                           "Degree 20\n"
+                           "Auto\n"
+                           "Smoothing spline\n"
+                           "B-spline");
     lv_dropdown_set_selected(degree_dropdown, 1); // Default to quadratic
     lv_obj_set_size(degree_dropdown, SIDEBAR_WIDTH - 60, 40);
     lv_obj_align(degree_dropdown, LV_ALIGN_TOP_MID, 0, 50);
@@ -96,10 +293,26 @@ void CurveFittingUI::createUI() {
     lv_obj_set_style_text_color(degree_dropdown, lv_color_hex(TEXT_COLOR), 0);
     lv_obj_set_style_border_color(degree_dropdown, lv_color_hex(0x45475A), 0);
     
+    // Add fit method dropdown: plain least squares, a robust fit that
+    // discounts stray points, or RANSAC, which rejects them outright
+    method_dropdown = lv_dropdown_create(sidebar);
+    lv_dropdown_set_options(method_dropdown, 
+                           "Least squares\n"
+                           "Robust (Huber)\n"
+                           "Robust (Tukey)\n"
+                           "RANSAC");
+    lv_dropdown_set_selected(method_dropdown, 0);
+    lv_obj_set_size(method_dropdown, SIDEBAR_WIDTH - 60, 40);
+    lv_obj_align(method_dropdown, LV_ALIGN_TOP_MID, 0, 100);
+    lv_obj_add_event_cb(method_dropdown, method_dropdown_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_set_style_bg_color(method_dropdown, lv_color_hex(DROPDOWN_BG_COLOR), 0);
+    lv_obj_set_style_text_color(method_dropdown, lv_color_hex(TEXT_COLOR), 0);
+    lv_obj_set_style_border_color(method_dropdown, lv_color_hex(0x45475A), 0);
+    
     // Create "Plot Curve" button
     plot_btn = lv_btn_create(sidebar);
     lv_obj_set_size(plot_btn, SIDEBAR_WIDTH - 60, 50);
-    lv_obj_align(plot_btn, LV_ALIGN_TOP_MID, 0, 120);
+    lv_obj_align(plot_btn, LV_ALIGN_TOP_MID, 0, 150);
     lv_obj_set_style_bg_color(plot_btn, lv_color_hex(BUTTON_PLOT_COLOR), 0);
     lv_obj_set_style_bg_opa(plot_btn, LV_OPA_90, 0);
     lv_obj_set_style_shadow_width(plot_btn, 15, 0);
@@ -119,7 +332,7 @@ void CurveFittingUI::createUI() {
     // Create "Clear All" button
     clear_btn = lv_btn_create(sidebar);
     lv_obj_set_size(clear_btn, SIDEBAR_WIDTH - 60, 50);
-    lv_obj_align(clear_btn, LV_ALIGN_TOP_MID, 0, 190);
+    lv_obj_align(clear_btn, LV_ALIGN_TOP_MID, 0, 210);
     lv_obj_set_style_bg_color(clear_btn, lv_color_hex(BUTTON_CLEAR_COLOR), 0);
     lv_obj_set_style_bg_opa(clear_btn, LV_OPA_90, 0);
     lv_obj_set_style_shadow_width(clear_btn, 15, 0);
@@ -136,12 +349,20 @@ void CurveFittingUI::createUI() {
     lv_obj_set_style_text_color(clear_label, lv_color_hex(0x1E1E2E), 0);
     lv_obj_center(clear_label);
     
+    // Add live fit switch: refit and redraw while points are dragged
+    live_checkbox = lv_checkbox_create(sidebar);
+    lv_checkbox_set_text(live_checkbox, "Live fit");
+    lv_obj_set_style_text_color(live_checkbox, lv_color_hex(TEXT_COLOR), 0);
+    lv_obj_set_width(live_checkbox, SIDEBAR_WIDTH - 60);
+    lv_obj_align(live_checkbox, LV_ALIGN_TOP_MID, 0, 270);
+    lv_obj_add_event_cb(live_checkbox, live_checkbox_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    
     // Create status label
     status_label = lv_label_create(sidebar);
     lv_label_set_text(status_label, "Ready");
     lv_obj_set_style_text_color(status_label, lv_color_hex(TEXT_COLOR), 0);
     lv_obj_set_width(status_label, SIDEBAR_WIDTH - 60);
-    lv_obj_align(status_label, LV_ALIGN_TOP_MID, 0, 260);
+    lv_obj_align(status_label, LV_ALIGN_TOP_MID, 0, 300);
     lv_label_set_long_mode(status_label, LV_LABEL_LONG_WRAP);
 }
 
@@ -159,8 +380,29 @@ void CurveFittingUI::drawAxis() {
         y_min = 0;
         y_max = 10;
         axis_initialized = true;
+        axis_layer_valid = false;
     }
     
+    // The axis only changes with the viewport. Otherwise only the tiles
+    // points or the curve were drawn on are copied back from the layer.
+    if (axis_layer_valid) {
+        content_tiles.forEachRect([this](int x, int y, int width, int height) {
+            for (int row = y; row < y + height; row++) {
+                memcpy(cbuf + row * CANVAS_WIDTH + x, axis_layer + row * CANVAS_WIDTH + x,
+                       width * sizeof(lv_color_t));
+            }
+        });
+        dirty_tiles |= content_tiles;
+    } else {
+        renderAxisLayer();
+        dirty_tiles.markAll();
+    }
+    content_tiles.clear();
+}
+
+// Draw background, axis, ticks and labels onto the canvas and keep a copy
+// of the result as the axis layer
+void CurveFittingUI::renderAxisLayer() {
     // Clear canvas and set background
     lv_canvas_fill_bg(canvas, lv_color_hex(CANVAS_BG_COLOR), LV_OPA_COVER);
     
@@ -195,12 +437,7 @@ void CurveFittingUI::drawAxis() {
     lv_draw_rect_dsc_init(&tick_dsc);
     tick_dsc.bg_color = lv_color_hex(AXIS_COLOR);
     
-    // Initialize text style
-    lv_draw_label_dsc_t label_dsc;
-    lv_draw_label_dsc_init(&label_dsc);
-    label_dsc.color = lv_color_hex(TEXT_COLOR);
-    
-    char label_text[10];
+    char label_text[24];
     
     // X-axis ticks
     for (int i = 0; i <= 10; i++) {
@@ -209,12 +446,11 @@ void CurveFittingUI::drawAxis() {
         // Draw tick
         lv_canvas_draw_rect(canvas, tick_x, origin_y, 1, 5, &tick_dsc);
         
-        // Draw label, but skip 0 which is at origin
+        // Draw label, but skip the origin, which is labelled below
         if (i > 0) {
-            float value = x_min + (i * (x_max - x_min)) / 10;
-            sprintf(label_text, "%d", (int)value);
-            lv_canvas_draw_text(canvas, tick_x - 10, origin_y + 10, 20, 
-                               &label_dsc, label_text);
+            formatTick(label_text, sizeof(label_text), x_min + (i * (x_max - x_min)) / 10,
+                       (x_max - x_min) / 10);
+            drawLabel(tick_x - 20, origin_y + 10, 40, LV_TEXT_ALIGN_CENTER, label_text);
         }
     }
     
@@ -225,26 +461,92 @@ void CurveFittingUI::drawAxis() {
         // Draw tick
         lv_canvas_draw_rect(canvas, origin_x - 5, tick_y, 5, 1, &tick_dsc);
         
-        // Draw label, but skip 0 which is at origin
+        // Draw label, but skip the origin, which is labelled below
         if (i > 0) {
-            float value = y_min + (i * (y_max - y_min)) / 10;
-            sprintf(label_text, "%d", (int)value);
-            lv_canvas_draw_text(canvas, origin_x - 25, tick_y - 5, 20, 
-                               &label_dsc, label_text);
+            formatTick(label_text, sizeof(label_text), y_min + (i * (y_max - y_min)) / 10,
+                       (y_max - y_min) / 10);
+            drawLabel(origin_x - 42, tick_y - 5, 36, LV_TEXT_ALIGN_RIGHT, label_text);
         }
     }
     
     // Draw axis labels
-    lv_canvas_draw_text(canvas, origin_x + axis_width - 20, origin_y + 25, 20, 
-                       &label_dsc, "X");
-    lv_canvas_draw_text(canvas, origin_x - 25, origin_y - axis_height - 5, 20, 
-                       &label_dsc, "Y");
+    drawLabel(origin_x + axis_width - 20, origin_y + 25, 20, LV_TEXT_ALIGN_LEFT, "X");
+    drawLabel(origin_x - 25, origin_y - axis_height - 5, 20, LV_TEXT_ALIGN_LEFT, "Y");
+    
+    // Draw origin label: one value if both axes start at it, else x
+    // below the origin and y to its left
+    formatTick(label_text, sizeof(label_text), x_min, (x_max - x_min) / 10);
+    if (x_min == y_min) {
+        drawLabel(origin_x - 25, origin_y + 10, 40, LV_TEXT_ALIGN_LEFT, label_text);
+    } else {
+        drawLabel(origin_x - 20, origin_y + 10, 40, LV_TEXT_ALIGN_CENTER, label_text);
+        formatTick(label_text, sizeof(label_text), y_min, (y_max - y_min) / 10);
+        drawLabel(origin_x - 42, origin_y - 5, 36, LV_TEXT_ALIGN_RIGHT, label_text);
+    }
     
-    // Draw origin label
-    lv_canvas_draw_text(canvas, origin_x - 25, origin_y + 10, 20, 
-                       &label_dsc, "0");
+    if (axis_layer) {
+        memcpy(axis_layer, cbuf, LV_CANVAS_BUF_SIZE_TRUE_COLOR(CANVAS_WIDTH, CANVAS_HEIGHT));
+        axis_layer_valid = true;
+    }
+}
+
+// Render the glyphs of the tick labels once with the label font, white
+// on black along the top of the canvas, and keep their coverage. The
+// canvas is cleared by the first axis render right after.
+void CurveFittingUI::buildGlyphAtlas() {
+    lv_draw_label_dsc_t label_dsc;
+    lv_draw_label_dsc_init(&label_dsc);
+    label_dsc.color = lv_color_white();
+    
+    const char* charset = GlyphAtlas::kCharset;
+    int glyphs = (int)strlen(charset);
+    int max_advance = 0;
+    for (int i = 0; i < glyphs; i++) {
+        max_advance = std::max(max_advance,
+                               (int)lv_font_get_glyph_width(label_dsc.font, charset[i], 0));
+    }
+    glyph_atlas.reset(lv_font_get_line_height(label_dsc.font), max_advance);
+    int cell_width = glyph_atlas.cellWidth();
+    if (glyphs * cell_width > CANVAS_WIDTH || glyph_atlas.lineHeight() > CANVAS_HEIGHT) {
+        // Labels are drawn by LVGL instead
+        glyph_atlas.reset(0, 0);
+        return;
+    }
+    
+    lv_canvas_fill_bg(canvas, lv_color_black(), LV_OPA_COVER);
+    for (int i = 0; i < glyphs; i++) {
+        char text[2] = {charset[i], '\0'};
+        lv_canvas_draw_text(canvas, i * cell_width + GlyphAtlas::kMargin, 0, cell_width,
+                            &label_dsc, text);
+    }
+    for (int i = 0; i < glyphs; i++) {
+        glyph_atlas.add(charset[i], lv_font_get_glyph_width(label_dsc.font, charset[i], 0),
+                        &cbuf[i * cell_width].full, CANVAS_WIDTH);
+    }
+}
+
+// Draw text in the label color where lv_canvas_draw_text would put it in
+// a box max_width wide at (x, y), composed from the glyph atlas when it
+// holds every character
+void CurveFittingUI::drawLabel(int x, int y, int max_width, lv_text_align_t align,
+                               const char* text) {
+    if (!glyph_atlas.covers(text)) {
+        lv_draw_label_dsc_t label_dsc;
+        lv_draw_label_dsc_init(&label_dsc);
+        label_dsc.color = lv_color_hex(TEXT_COLOR);
+        label_dsc.align = align;
+        lv_canvas_draw_text(canvas, x, y, max_width, &label_dsc, text);
+        return;
+    }
     
-    lv_obj_invalidate(canvas);
+    int width = glyph_atlas.textWidth(text);
+    if (align == LV_TEXT_ALIGN_CENTER) {
+        x += (max_width - width) / 2;
+    } else if (align == LV_TEXT_ALIGN_RIGHT) {
+        x += max_width - width;
+    }
+    glyph_atlas.draw(&cbuf->full, CANVAS_WIDTH, CANVAS_HEIGHT, x, y, text,
+                     lv_color_hex(TEXT_COLOR).full);
 }
 
 void CurveFittingUI::convertToCanvasCoords(float x, float y, int& canvas_x, int& canvas_y) {
@@ -262,6 +564,44 @@ void CurveFittingUI::convertToCanvasCoords(float x, float y, int& canvas_x, int&
     canvas_y = origin_y - (int)(y_ratio * axis_height);
 }
 
+// The same map as convertToCanvasCoords, without the truncation, and the
+// plot area inside the axes as the clip rectangle
+PlotMapping CurveFittingUI::plotMapping() const {
+    return plotMapping(viewport());
+}
+
+PlotMapping CurveFittingUI::plotMapping(const Viewport& view) const {
+    float x_min = view.x_min, x_max = view.x_max;
+    float y_min = view.y_min, y_max = view.y_max;
+    int origin_x = 40;
+    int origin_y = CANVAS_HEIGHT - 40;
+    int axis_width = CANVAS_WIDTH - 60;
+    int axis_height = CANVAS_HEIGHT - 60;
+    
+    PlotMapping mapping;
+    mapping.x_scale = axis_width / (x_max - x_min);
+    mapping.x_offset = origin_x - x_min * mapping.x_scale;
+    mapping.y_scale = -axis_height / (y_max - y_min);
+    mapping.y_offset = origin_y - y_min * mapping.y_scale;
+    mapping.left = origin_x;
+    mapping.top = origin_y - axis_height;
+    mapping.right = origin_x + axis_width;
+    mapping.bottom = origin_y;
+    return mapping;
+}
+
+CurveFittingUI::Viewport CurveFittingUI::viewport() const {
+    Viewport view = {x_min, x_max, y_min, y_max};
+    return view;
+}
+
+void CurveFittingUI::setViewport(const Viewport& view) {
+    x_min = view.x_min;
+    x_max = view.x_max;
+    y_min = view.y_min;
+    y_max = view.y_max;
+}
+
 void CurveFittingUI::convertFromCanvasCoords(int canvas_x, int canvas_y, float& x, float& y) {
     // Calculate position of x and y axis
     int origin_x = 40;
@@ -278,74 +618,348 @@ void CurveFittingUI::convertFromCanvasCoords(int canvas_x, int canvas_y, float&
 }
 
 void CurveFittingUI::addPoint(float x, float y) {
-    if (points.size() < MAX_POINTS) {
-        points.push_back(Point(x, y));
+    if (points.size() >= MAX_POINTS) {
+        updateStatusText("Maximum points reached!");
+        return;
+    }
+    appendPoint(x, y);
+    if (live_fit) {
+        liveFrame();
+        return;
+    }
+    
+    // An envelope or density map is redrawn as a whole. A dot is drawn on
+    // its own and everything else on the canvas stays as it is.
+    if (pointView() != PointView::Dots) {
         drawPoints();
+        return;
+    }
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    drawPoint(points.size() - 1);
+    flushDirtyTiles();
+#if CURVE_FIT_PROFILE
+    Serial.printf("tap: render %lu cycles\n",
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+}
+
+void CurveFittingUI::addPoints(const float* x, const float* y, size_t count) {
+    size_t added = std::min(count, (size_t)MAX_POINTS - points.size());
+    for (size_t i = 0; i < added; i++) {
+        appendPoint(x[i], y[i]);
+    }
+    if (live_fit) {
+        liveFrame();
     } else {
+        drawPoints();
+    }
+    
+    if (added < count) {
         updateStatusText("Maximum points reached!");
+    } else {
+        char status_text[50];
+        sprintf(status_text, "Added %u points", (unsigned)added);
+        updateStatusText(status_text);
+    }
+}
+
+// Add a point to the store and the running sums, without drawing it
+void CurveFittingUI::appendPoint(float x, float y) {
+    if (points_sorted && !points.empty() && x < points.back().x) {
+        // No longer a series
+        points_sorted = false;
+        envelope.clear();
+    }
+    cv_folds[points.size() % CV_FOLDS].add(x, y);
+    points.push_back(Point(x, y));
+    moments.add(x, y);
+}
+
+// Draw one data point, in its own color if the last fit rejected it
+void CurveFittingUI::drawPoint(size_t index) {
+    // Points panned far off the canvas would overflow the conversion
+    PlotMapping mapping = plotMapping();
+    float pixel_x = mapping.pixelX(points[index].x);
+    float pixel_y = mapping.pixelY(points[index].y);
+    if (!(pixel_x > -POINT_RADIUS && pixel_x < CANVAS_WIDTH + POINT_RADIUS &&
+          pixel_y > -POINT_RADIUS && pixel_y < CANVAS_HEIGHT + POINT_RADIUS)) {
+        return;
     }
+    
+    int canvas_x, canvas_y;
+    convertToCanvasCoords(points[index].x, points[index].y, canvas_x, canvas_y);
+    
+    bool outlier = fit && index < fit->outliers.size() && fit->outliers[index];
+    lv_color_t color = lv_color_hex(outlier ? OUTLIER_COLOR : POINT_COLOR);
+    
+    // Centred on the 2 * POINT_RADIUS square the dot has always covered
+    raster.fillDisc(canvas_x - 0.5f, canvas_y - 0.5f, POINT_RADIUS, color.full);
+    markDrawn(canvas_x - POINT_RADIUS, canvas_y - POINT_RADIUS,
+              canvas_x + POINT_RADIUS, canvas_y + POINT_RADIUS);
 }
 
 void CurveFittingUI::drawPoints() {
-    // Redraw axis to clear previous points
+    // Restore the axis layer to clear previous points
     drawAxis();
     
-    // Define circle style for points
-    lv_draw_rect_dsc_t point_dsc;
-    lv_draw_rect_dsc_init(&point_dsc);
-    point_dsc.bg_color = lv_color_hex(POINT_COLOR);
-    point_dsc.radius = POINT_RADIUS;
+    // Bands go under the points, the curve over them
+    if (fit && fit->view == viewport()) {
+        drawBands();
+    }
     
-    // Draw each point
-    for (size_t i = 0; i < points.size(); i++) {
-        int canvas_x, canvas_y;
-        convertToCanvasCoords(points[i].x, points[i].y, canvas_x, canvas_y);
-        
-        lv_canvas_draw_rect(canvas, canvas_x - POINT_RADIUS, canvas_y - POINT_RADIUS, 
-                           POINT_RADIUS * 2, POINT_RADIUS * 2, &point_dsc);
+    switch (pointView()) {
+        case PointView::Dots:
+            for (size_t i = 0; i < points.size(); i++) {
+                drawPoint(i);
+            }
+            break;
+        case PointView::Envelope:
+            drawEnvelope();
+            break;
+        case PointView::Density:
+            drawDensity();
+            break;
     }
     
-    // Draw the curve if we have one
-    if (!curve_points.empty()) {
+    // Draw the curve if we have one for this viewport
+    if (fit && fit->view == viewport() && !fit->polyline.empty()) {
         drawCurve();
     }
     
-    lv_obj_invalidate(canvas);
+    flushDirtyTiles();
 }
 
-void CurveFittingUI::drawCurve() {
-    if (curve_points.size() < 2) return;
+CurveFittingUI::PointView CurveFittingUI::pointView() const {
+    if (points.size() <= DOT_POINT_LIMIT) return PointView::Dots;
+    return points_sorted ? PointView::Envelope : PointView::Density;
+}
+
+// Draw a series as the span of its points in each pixel column, joined to
+// where it went on in the next column with points. The cost follows the
+// number of columns, not of points. Outliers are not told apart.
+void CurveFittingUI::drawEnvelope() {
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    envelope.append(points.data(), points.size());
+    PlotMapping mapping = plotMapping();
+    lv_color_t color = lv_color_hex(POINT_COLOR);
     
-    // Define line style for curve
-    lv_draw_line_dsc_t line_dsc;
-    lv_draw_line_dsc_init(&line_dsc);
-    line_dsc.color = lv_color_hex(CURVE_COLOR);
-    line_dsc.width = 2;
+    // Column c is canvas column left + c: x within half a pixel of its
+    // centre. Lines across a gap are clamped to a canvas height beyond the
+    // plot, so far-off points cannot overflow the pixel coordinates.
+    int left = (int)mapping.left;
+    int columns = (int)mapping.right - left + 1;
+    float width = 1.0f / mapping.x_scale;
+    float x0 = (left - 0.5f - mapping.x_offset) * width;
+    float reach_top = mapping.top - CANVAS_HEIGHT;
+    float reach_bottom = mapping.bottom + CANVAS_HEIGHT;
     
-    // Draw line segments connecting curve points
-    for (size_t i = 0; i < curve_points.size() - 1; i++) {
-        int x1, y1, x2, y2;
-        convertToCanvasCoords(curve_points[i].x, curve_points[i].y, x1, y1);
-        convertToCanvasCoords(curve_points[i+1].x, curve_points[i+1].y, x2, y2);
-        
-        lv_point_t line_points[] = {
-            {x1, y1},
-            {x2, y2}
-        };
+    int drawn = 0;
+    int previous_column = -1;
+    float previous_y = 0.0f;
+    envelope.forEachColumn(points.data(), x0, width, columns,
+                           [&](int c, size_t first, size_t last, float low, float high) {
+        float top = mapping.pixelY(high);
+        float bottom = mapping.pixelY(low);
+        float entry_y = std::min(std::max(mapping.pixelY(points[first].y), reach_top), reach_bottom);
+        if (previous_column == c - 1) {
+            top = std::min(top, previous_y);
+            bottom = std::max(bottom, previous_y);
+        } else if (previous_column >= 0) {
+            raster.drawLine(left + previous_column, previous_y, left + c, entry_y, 1.0f,
+                            color.full);
+            markDrawnLine(left + previous_column, (int)previous_y, left + c, (int)entry_y, 1);
+        }
+        previous_column = c;
+        previous_y = std::min(std::max(mapping.pixelY(points[last - 1].y), reach_top),
+                              reach_bottom);
         
-        lv_canvas_draw_line(canvas, line_points, 2, &line_dsc);
+        if (bottom < mapping.top || top > mapping.bottom) return;
+        int y0 = (int)std::lround(std::max(top, mapping.top));
+        int y1 = (int)std::lround(std::min(bottom, mapping.bottom));
+        raster.fillRect(left + c, y0, left + c, y1, color.full);
+        markDrawn(left + c, y0, left + c, y1);
+        drawn++;
+    });
+#if CURVE_FIT_PROFILE
+    Serial.printf("envelope: %d columns for %u points, %lu cycles\n", drawn,
+                  (unsigned)points.size(),
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#else
+    (void)drawn;
+#endif
+}
+
+// Draw a scatter too dense for dots as a heat map of points per pixel.
+// All points are binned again only when the viewport has changed; those
+// added since the last frame are binned as they come. Drawing then walks
+// the plot pixels once, however many points there are.
+void CurveFittingUI::drawDensity() {
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    Viewport view = viewport();
+    if (!density_valid || !(density_view == view)) {
+        density.reset(plotMapping(view));
+        density_view = view;
+        density_valid = true;
+        density_points = 0;
+    }
+    for (; density_points < points.size(); density_points++) {
+        density.add(points[density_points].x, points[density_points].y);
+    }
+#if CURVE_FIT_PROFILE
+    uint32_t bin_cycles = esp_cpu_get_cycle_count() - start_cycles;
+#endif
+    
+    PlotMapping mapping = plotMapping();
+    int left = (int)mapping.left;
+    int top = (int)mapping.top;
+    lv_color_t color = lv_color_hex(POINT_COLOR);
+    density.forEachBin([&](int column, int row, uint32_t alpha) {
+        raster.fillPixel(left + column, top + row, color.full, alpha);
+    });
+    for (int row = 0; row < density.height(); row++) {
+        int first, last;
+        if (density.rowExtent(row, first, last)) {
+            markDrawn(left + first, top + row, left + last, top + row);
+        }
     }
+#if CURVE_FIT_PROFILE
+    Serial.printf("density: bin %lu cycles, shade %lu cycles\n", (unsigned long)bin_cycles,
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles - bin_cycles));
+#endif
+}
+
+void CurveFittingUI::drawCurve() {
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    lv_color_t color = lv_color_hex(CURVE_COLOR);
+    const CurveTessellator<lv_point_t>& polyline = fit->polyline;
     
-    lv_obj_invalidate(canvas);
+    // One polyline per stretch of the curve inside the plot area
+    for (int r = 0; r < polyline.runCount(); r++) {
+        const lv_point_t *run = polyline.run(r);
+        int length = polyline.runLength(r);
+        raster.drawPolyline(run, length, CURVE_WIDTH, color.full);
+        
+        // Segment by segment, so only the tiles along the curve are
+        // restored and flushed next time, not its whole bounding box
+        for (int i = 1; i < length; i++) {
+            markDrawnLine(run[i - 1].x, run[i - 1].y, run[i].x, run[i].y, CURVE_WIDTH);
+        }
+    }
+#if CURVE_FIT_PROFILE
+    Serial.printf("curve: draw %d segments in %d runs, %lu cycles\n",
+                  polyline.segmentCount(), polyline.runCount(),
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+}
+
+// Shade the prediction band and the confidence band inside it. The bands
+// are filled as spans, so they cost about one blend per pixel covered.
+void CurveFittingUI::drawBands() {
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    lv_color_t color = lv_color_hex(BAND_COLOR);
+    const FitBand *bands[] = {&fit->prediction, &fit->confidence};
+    const uint32_t alphas[] = {PREDICTION_BAND_ALPHA, CONFIDENCE_BAND_ALPHA};
+    const int tile = TileMask<CANVAS_WIDTH, CANVAS_HEIGHT>::kTileSize;
+    for (int b = 0; b < 2; b++) {
+        const FitBand& band = *bands[b];
+        int count = (int)band.top.size();
+        if (count == 0 || alphas[b] == 0) continue;
+        raster.fillBand(band.left, band.top.data(), band.bottom.data(), count, color.full,
+                        alphas[b]);
+        
+        // One tile column at a time, down the rows the band covers there
+        for (int c0 = 0, c1; c0 < count; c0 = c1) {
+            c1 = std::min(c0 + tile - (band.left + c0) % tile, count);
+            int top = CANVAS_HEIGHT;
+            int bottom = -1;
+            for (int c = c0; c < c1; c++) {
+                if (band.top[c] > band.bottom[c]) continue;
+                top = std::min(top, (int)band.top[c]);
+                bottom = std::max(bottom, (int)band.bottom[c]);
+            }
+            if (top <= bottom) markDrawn(band.left + c0, top, band.left + c1 - 1, bottom);
+        }
+    }
+#if CURVE_FIT_PROFILE
+    Serial.printf("bands: draw %d columns, %lu cycles\n", (int)fit->prediction.top.size(),
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+}
+
+// Record that pixels x0..x1, y0..y1 of the canvas were drawn over
+void CurveFittingUI::markDrawn(int x0, int y0, int x1, int y1) {
+    dirty_tiles.mark(x0, y0, x1, y1);
+    content_tiles.mark(x0, y0, x1, y1);
+}
+
+// Record a line drawn from (x0, y0) to (x1, y1), pad pixels wide on
+// either side, in pieces about a tile long
+void CurveFittingUI::markDrawnLine(int x0, int y0, int x1, int y1, int pad) {
+    const int tile = TileMask<CANVAS_WIDTH, CANVAS_HEIGHT>::kTileSize;
+    int pieces = std::max(std::abs(x1 - x0), std::abs(y1 - y0)) / tile + 1;
+    int from_x = x0;
+    int from_y = y0;
+    for (int k = 1; k <= pieces; k++) {
+        int to_x = x0 + (x1 - x0) * k / pieces;
+        int to_y = y0 + (y1 - y0) * k / pieces;
+        markDrawn(std::min(from_x, to_x) - pad, std::min(from_y, to_y) - pad,
+                  std::max(from_x, to_x) + pad, std::max(from_y, to_y) + pad);
+        from_x = to_x;
+        from_y = to_y;
+    }
+}
+
+// Hand the tiles changed since the last flush to LVGL, so only they are
+// flushed to the frame buffers
+void CurveFittingUI::flushDirtyTiles() {
+    lv_area_t coords;
+    lv_obj_get_coords(canvas, &coords);
+    dirty_tiles.forEachRect([&coords, this](int x, int y, int width, int height) {
+        lv_area_t area = {
+            (lv_coord_t)(coords.x1 + x), (lv_coord_t)(coords.y1 + y),
+            (lv_coord_t)(coords.x1 + x + width - 1), (lv_coord_t)(coords.y1 + y + height - 1)
+        };
+        lv_obj_invalidate_area(canvas, &area);
+    });
+    dirty_tiles.clear();
 }
 
 void CurveFittingUI::clearCanvas() {
-    points.clear();
-    curve_points.clear();
+    resetPoints();
     drawAxis();
+    flushDirtyTiles();
     updateStatusText("Canvas cleared");
 }
 
+// Forget the points, the fit and the views of the points
+void CurveFittingUI::resetPoints() {
+    points.clear();
+    moments.clear();
+    for (int f = 0; f < CV_FOLDS; f++) {
+        cv_folds[f].clear();
+    }
+    points_sorted = true;
+    envelope.clear();
+    density_valid = false;
+    
+    // Whatever the worker is doing is about the old points, and new ones
+    // will be written where it reads them
+    fit_epoch = fit_worker.cancelAndWait();
+    fit = nullptr;
+    fit_job = 0;
+    shown_job = 0;
+}
+
 void CurveFittingUI::plotCurve() {
     if (points.size() < 2) {
         updateStatusText("Need at least 2 points!");
@@ -354,80 +968,559 @@ void CurveFittingUI::plotCurve() {
     
     updateStatusText("Calculating curve...");
     
-    // Perform polynomial fitting directly on ESP32
-    calculatePolynomialFit();
+    // The fit worker takes it from here; points and curve are drawn when
+    // the result comes back
+    submitFit(true);
+}
+
+void CurveFittingUI::showFitStatus() {
+    if (fit) updateStatusText(fit->status);
+}
+
+// Ask the fit worker for a fit of the points as they are now, with the
+// curve tessellated for the current viewport
+void CurveFittingUI::submitFit(bool cancel_running) {
+    FitJob job;
+    job.refit = true;
+    job.points = points.data();
+    job.count = (int)points.size();
+    job.moved = gesture == Gesture::Drag ? live_point : -1;
+    if (job.moved >= 0) job.moved_point = points[live_point];
+    job.polynomial_degree = polynomial_degree;
+    job.fit_method = fit_method;
+    job.view = viewport();
+    job.moments = moments;
+    std::copy(cv_folds, cv_folds + CV_FOLDS, job.cv_folds);
+    fit_job = fit_worker.submit(job, cancel_running);
+}
+
+// Ask for the curve on screen again, tessellated for the current
+// viewport. A job replaces the one waiting in the queue, so while a refit
+// is outstanding the refit is asked for again instead.
+void CurveFittingUI::submitRedraw() {
+    if (fit_job > shown_job) {
+        submitFit(false);
+    } else if (fit) {
+        FitJob job;
+        job.refit = false;
+        job.points = nullptr;
+        job.count = 0;
+        job.moved = -1;
+        job.polynomial_degree = polynomial_degree;
+        job.fit_method = fit_method;
+        job.view = viewport();
+        fit_worker.submit(job, true);
+    }
+}
+
+// Take a finished result from the fit worker, or show how far the refit
+// in flight has come
+void CurveFittingUI::pollFit() {
+    uint32_t id;
+    const FitResult *result = fit_worker.take(id);
+    if (result) {
+        showFit(result, id);
+        return;
+    }
+    if (live_fit || fit_job <= shown_job || fit_worker.runningJob() != fit_job) return;
+    int percent = (int)(fit_worker.progress() * 100.0f);
+    if (percent != fit_progress) {
+        fit_progress = percent;
+        char status_text[50];
+        sprintf(status_text, "Calculating curve... %d%%", percent);
+        updateStatusText(status_text);
+    }
+}
+
+// Put a result from the fit worker on screen. During a pan or pinch only
+// the preview is shown, so it waits for the settled redraw.
+void CurveFittingUI::showFit(const FitResult* result, uint32_t id) {
+    if (id < fit_epoch) {
+        fit = nullptr;
+        return;
+    }
+    fit = result;
+    shown_job = id;
+    fit_progress = -1;
+    if (gesture == Gesture::Pan || gesture == Gesture::Pinch || preview_shown) return;
     
-    // Draw points and curve
+    unsigned long start_us = micros();
     drawPoints();
-    updateStatusText("Curve plotted successfully!");
+    unsigned long end_us = micros();
+    if (!result->refit) return;
+    if (gesture == Gesture::None) showFitStatus();
+    if (!live_fit) return;
+    
+    // Averaged over roughly the last eight frames; the first frame of a
+    // gesture has no period
+    const float weight = 0.125f;
+    frame_fit_ms += weight * (result->fit_ms - frame_fit_ms);
+    frame_draw_ms += weight * ((end_us - start_us) * 1e-3f - frame_draw_ms);
+    if (frame_time_us) {
+        frame_period_ms += weight * ((start_us - frame_time_us) * 1e-3f - frame_period_ms);
+    }
+    frame_time_us = start_us;
+    
+    char frame_text[64];
+    snprintf(frame_text, sizeof(frame_text), "fit %.1f ms  draw %.1f ms  %.0f fps",
+             frame_fit_ms, frame_draw_ms, frame_period_ms > 0 ? 1000.0f / frame_period_ms : 0.0f);
+    lv_label_set_text(frame_label, frame_text);
+}
+
+// Describe the last fit for the status label
+void CurveFittingUI::describeFit(const FitJob& job) {
+    int len;
+    if (job.polynomial_degree == SMOOTHING_SPLINE_DEGREE) {
+        len = sprintf(fit_status, "Smoothing spline plotted (%d knots)",
+                      smoothing_spline_fit.knotCount());
+    } else if (job.polynomial_degree == BSPLINE_DEGREE) {
+        len = sprintf(fit_status, "B-spline plotted (%d segments)",
+                      bspline_fit.basisCount() - 3);
+    } else if (job.polynomial_degree == AUTO_DEGREE) {
+        len = sprintf(fit_status, "Curve plotted, auto degree %d", fitted_degree);
+    } else {
+        len = sprintf(fit_status, "Curve plotted (degree %d)", fitted_degree);
+    }
+    if (fit_stride > 1 && curve_source != CurveSource::Monomial) {
+        len += sprintf(fit_status + len, "\nFit to %d of %d points", (int)fit_subset.size(),
+                       job.count);
+    }
+    if (!std::isfinite(cv_rmse)) {
+        // Too few points to hold any out
+    } else if (cv_leave_one_out) {
+        len += sprintf(fit_status + len, "\nLOO-CV RMSE %.3f", cv_rmse);
+    } else {
+        len += sprintf(fit_status + len, "\n%d-fold CV RMSE %.3f", CV_FOLDS, cv_rmse);
+    }
+    int outlier_count = std::count(outliers.begin(), outliers.end(), true);
+    bool spline = job.polynomial_degree == SMOOTHING_SPLINE_DEGREE ||
+                  job.polynomial_degree == BSPLINE_DEGREE;
+    if (spline) {
+        // Splines are always least squares
+    } else if (job.fit_method == FitMethod::Ransac) {
+        sprintf(fit_status + len, "\nRANSAC: %d hypotheses, %d outliers",
+                ransac_fit.hypotheses(), outlier_count);
+    } else if (job.fit_method != FitMethod::LeastSquares) {
+        sprintf(fit_status + len, "\n%s: %d iterations, %d outliers",
+                job.fit_method == FitMethod::Huber ? "Huber" : "Tukey",
+                robust_fit.iterations(), outlier_count);
+    }
 }
 
 void CurveFittingUI::clearPoints() {
-    points.clear();
-    curve_points.clear();
+    resetPoints();
     drawAxis();
+    flushDirtyTiles();
 }
 
-void CurveFittingUI::calculatePolynomialFit() {
-    if (points.size() < 2) return;
+// Fit the job's points with its settings. Runs on the fit worker; the
+// curve is left to evaluateCurve() for tessellation. Until the fit is
+// complete there is no curve to evaluate, so a cancelled fit leaves none.
+void CurveFittingUI::calculatePolynomialFit(const FitJob& job) {
+    curve_source = CurveSource::None;
+    band_scale = NAN;
+    if (job.count < 2) return;
     
-    int n = points.size();
-    int degree = polynomial_degree;
+    const Point *points = job.points;
+    int n = job.count;
     
-    // Create matrices for the linear system
-    Eigen::MatrixXf A(n, degree + 1);
-    Eigen::VectorXf b(n);
+    // The point a drag moves is read from the job, as the UI keeps writing
+    // it in the store
+    auto point = [&job, points](int i) -> const Point& {
+        return i == job.moved ? job.moved_point : points[i];
+    };
     
-    // Fill matrices
-    for (int i = 0; i < n; i++) {
-        float x = points[i].x;
-        float y = points[i].y;
-        
-        // Fill powers of x in the A matrix
-        for (int j = 0; j <= degree; j++) {
-            A(i, j) = pow(x, j);
+    // n points, or rather their distinct x values, determine at most a
+    // polynomial of one degree less. Splines are piecewise cubic.
+    bool auto_degree = job.polynomial_degree == AUTO_DEGREE;
+    bool smoothing_spline = job.polynomial_degree == SMOOTHING_SPLINE_DEGREE;
+    bool bspline = job.polynomial_degree == BSPLINE_DEGREE;
+    bool spline = smoothing_spline || bspline;
+    int degree = spline ? 3 : std::min(auto_degree ? MAX_FIT_DEGREE : job.polynomial_degree, n - 1);
+    
+    // The engines with per-point buffers see every fit_stride-th point of
+    // a set larger than MAX_FIT_POINTS, and the monomial fits score their
+    // cross-validation and bands on those points alone
+    fit_stride = (n + MAX_FIT_POINTS - 1) / MAX_FIT_POINTS;
+    while (fit_stride % CV_FOLDS == 0) fit_stride++;
+    const Point *fit_points = points;
+    int fit_n = n;
+    if (fit_stride > 1 || job.moved >= 0) {
+        fit_subset.clear();
+        for (int i = 0; i < n; i += fit_stride) fit_subset.push_back(point(i));
+        fit_points = fit_subset.data();
+        fit_n = (int)fit_subset.size();
+    }
+    if (!spline) {
+        // At least a line, which the solvers level when x never varies
+        degree = std::max(1, std::min(degree, distinctX(fit_points, fit_n, degree + 1) - 1));
+    }
+    
+    // Everything the engines allocate from here on is scratch from the
+    // arena, released when the fit is done
+    Eigen::ArenaScope scratch(solver_arena);
+    
+#if CURVE_FIT_PROFILE
+    unsigned long allocs_before = Eigen::allocationCount();
+    unsigned long start_us = micros();
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    
+    // Low degrees solve the normal equations from the running moments with
+    // the fixed-size kernel for that degree. Higher degrees would make the
+    // monomial system too ill-conditioned for float, so they go through the
+    // orthogonal basis instead. Its basis is nested, so in auto mode one fit
+    // up to the highest degree scores every lower degree as well.
+    //
+    // The orthogonal fit gets its leave-one-out error from the leverages
+    // for free; monomial fits are cross-validated over the moment folds.
+    //
+    // Robust methods and RANSAC need per-point weights, so they always run
+    // in the orthogonal basis. Auto mode picks their degree from the plain
+    // fit. Their leave-one-out error is weighted, so rejected points do not
+    // count.
+    //
+    // Splines follow data no single polynomial can, at linear cost. They
+    // always fit by least squares, whatever the fit method.
+    //
+    // All but the moment fits work on fit_points, and the moment fits are
+    // scored on the same every fit_stride-th point. Points left out of it
+    // are flagged as outliers by their residual from the curve.
+    Coefficients coeffs;
+    float mean_cv_error;
+    bool robust = !spline && (job.fit_method == FitMethod::Huber || job.fit_method == FitMethod::Tukey);
+    bool ransac = !spline && job.fit_method == FitMethod::Ransac;
+    bool orthogonal = robust || ransac || auto_degree || degree > MAX_DEGREE;
+    if ((robust || ransac) && auto_degree) {
+        orthogonal_fit.fit(fit_points, fit_n, degree);
+        degree = orthogonal_fit.selectDegree(AUTO_DEGREE_CRITERION);
+    }
+    outliers.assign(n, false);
+    if (smoothing_spline) {
+        smoothing_spline_fit.fit(fit_points, fit_n, SPLINE_SMOOTHING);
+        mean_cv_error = NAN;
+    } else if (bspline) {
+        bspline_fit.fitUniform(fit_points, fit_n, BSPLINE_SEGMENTS);
+        mean_cv_error = NAN;
+    } else if (ransac) {
+        ransac_fit.fit(fit_points, fit_n, degree, RANSAC_THRESHOLD, 0.99f,
+                       RANSAC_MAX_HYPOTHESES);
+        degree = ransac_fit.degree();
+        for (int i = 0; i < n; i++) {
+            if (i % fit_stride == 0) {
+                outliers[i] = !ransac_fit.isInlier(i / fit_stride);
+            } else {
+                float r = point(i).y - ransac_fit(point(i).x);
+                outliers[i] = r * r > RANSAC_THRESHOLD * RANSAC_THRESHOLD;
+            }
         }
+        mean_cv_error = ransac_fit.weightedFit().press(degree) / ransac_fit.inlierCount();
+#if CURVE_FIT_PROFILE
+        Serial.printf("ransac: %d hypotheses, %d inliers, %lu cycles\n",
+                      ransac_fit.hypotheses(), ransac_fit.inlierCount(),
+                      (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+    } else if (robust) {
+#if CURVE_FIT_PROFILE
+        IterationProfile profile = { esp_cpu_get_cycle_count(), Eigen::allocationCount() };
+        robust_fit.setIterationCallback(logRobustIteration, &profile);
+#endif
+        RobustLoss loss = job.fit_method == FitMethod::Huber ? RobustLoss::Huber : RobustLoss::Tukey;
+        robust_fit.fit(fit_points, fit_n, degree, loss, ROBUST_MAX_ITERATIONS);
+        degree = robust_fit.degree();
         
-        // Fill y values in the b vector
-        b(i) = y;
+        // Points the fit gave (almost) no weight count as outliers
+        float weight_sum = 0.0f;
+        for (int i = 0; i < n; i++) {
+            float weight;
+            if (i % fit_stride == 0) {
+                weight = robust_fit.weights()(i / fit_stride);
+                weight_sum += weight;
+            } else {
+                weight = robust_fit.weight(point(i).y - robust_fit(point(i).x));
+            }
+            outliers[i] = weight < 0.5f;
+        }
+        mean_cv_error = robust_fit.weightedFit().press(degree) / weight_sum;
+    } else if (auto_degree) {
+        orthogonal_fit.fit(fit_points, fit_n, degree);
+        degree = orthogonal_fit.selectDegree(AUTO_DEGREE_CRITERION);
+        mean_cv_error = orthogonal_fit.press(degree) / fit_n;
+    } else if (orthogonal) {
+        orthogonal_fit.fit(fit_points, fit_n, degree);
+        degree = orthogonal_fit.degree();
+        mean_cv_error = orthogonal_fit.press(degree) / fit_n;
+    } else {
+        switch (degree) {
+            case 1:
+                fitPolynomial<1>(job.moments, coeffs, MOMENT_SOLVER, MOMENT_PRECISION,
+                                   &curve_covariance);
+                mean_cv_error = kFoldError<1>(job.cv_folds, fit_points, fit_n, MOMENT_SOLVER,
+                                              MOMENT_PRECISION, fit_stride);
+                break;
+            case 2:
+                fitPolynomial<2>(job.moments, coeffs, MOMENT_SOLVER, MOMENT_PRECISION,
+                                   &curve_covariance);
+                mean_cv_error = kFoldError<2>(job.cv_folds, fit_points, fit_n, MOMENT_SOLVER,
+                                              MOMENT_PRECISION, fit_stride);
+                break;
+            case 3:
+                fitPolynomial<3>(job.moments, coeffs, MOMENT_SOLVER, MOMENT_PRECISION,
+                                   &curve_covariance);
+                mean_cv_error = kFoldError<3>(job.cv_folds, fit_points, fit_n, MOMENT_SOLVER,
+                                              MOMENT_PRECISION, fit_stride);
+                break;
+            case 4:
+                fitPolynomial<4>(job.moments, coeffs, MOMENT_SOLVER, MOMENT_PRECISION,
+                                   &curve_covariance);
+                mean_cv_error = kFoldError<4>(job.cv_folds, fit_points, fit_n, MOMENT_SOLVER,
+                                              MOMENT_PRECISION, fit_stride);
+                break;
+            default:
+                fitPolynomial<MAX_DEGREE>(job.moments, coeffs, MOMENT_SOLVER, MOMENT_PRECISION,
+                                   &curve_covariance);
+                mean_cv_error = kFoldError<MAX_DEGREE>(job.cv_folds, fit_points, fit_n,
+                                                       MOMENT_SOLVER, MOMENT_PRECISION,
+                                                       fit_stride);
+                break;
+        }
+    }
+    // Residual sum of squares and degrees of freedom for the bands, from
+    // the engine that holds the fit. Weighted fits count their weights as
+    // points, so RANSAC's rejected points and the robust fits' downweighted
+    // ones hardly count.
+    float band_rss = NAN;
+    float band_dof = 0.0f;
+    if (spline) {
+        // A spline's bands would need its hat matrix
+    } else if (ransac) {
+        band_rss = ransac_fit.weightedFit().residualSumOfSquares(degree);
+        band_dof = ransac_fit.weightedFit().weightSum() - (degree + 1);
+    } else if (robust) {
+        band_rss = robust_fit.weightedFit().residualSumOfSquares(degree);
+        band_dof = robust_fit.weightedFit().weightSum() - (degree + 1);
+    } else if (orthogonal) {
+        band_rss = orthogonal_fit.residualSumOfSquares(degree);
+        band_dof = orthogonal_fit.weightSum() - (degree + 1);
+    } else {
+        // Scaled up from the points the other engines would see
+        band_rss = squaredError(fit_points, fit_n, coeffs.data(), degree) * n / fit_n;
+        band_dof = n - (degree + 1);
     }
     
-    // Solve the system using QR decomposition
-    Eigen::VectorXf coeffs = A.householderQr().solve(b);
+    // An interpolating fit leaves nothing to validate against
+    cv_rmse = n > degree + 1 ? std::sqrt(mean_cv_error) : NAN;
+    cv_leave_one_out = orthogonal;
     
-    // Generate curve points
-    curve_points.clear();
+#if CURVE_FIT_PROFILE
+    uint32_t solve_cycles = esp_cpu_get_cycle_count() - start_cycles;
+#endif
+    fitted_degree = degree;
     
     // Get min and max x values
-    float min_x = points[0].x;
-    float max_x = points[0].x;
+    float min_x = point(0).x;
+    float max_x = point(0).x;
     
-    for (size_t i = 1; i < points.size(); i++) {
-        if (points[i].x < min_x) min_x = points[i].x;
-        if (points[i].x > max_x) max_x = points[i].x;
+    for (int i = 1; i < n; i++) {
+        if (point(i).x < min_x) min_x = point(i).x;
+        if (point(i).x > max_x) max_x = point(i).x;
     }
     
-    // Add some margin to x range
-    min_x = std::max(x_min, min_x - 0.5f);
-    max_x = std::min(x_max, max_x + 0.5f);
+    // Add some margin to x range; tessellateCurve() limits it to the
+    // viewport
+    min_x -= 0.5f;
+    max_x += 0.5f;
     
-    // Generate 100 points along the curve
-    int num_curve_points = 100;
-    float step = (max_x - min_x) / (num_curve_points - 1);
+    // Remember which engine holds the curve, for tessellating it again.
+    // An engine stopped early holds a fit nobody will look at.
+    if (fit_worker.cancelled()) return;
+    if (smoothing_spline) {
+        curve_source = CurveSource::SmoothingSpline;
+    } else if (bspline) {
+        curve_source = CurveSource::BSpline;
+    } else if (ransac) {
+        curve_source = CurveSource::Ransac;
+    } else if (robust) {
+        curve_source = CurveSource::Robust;
+    } else if (orthogonal) {
+        curve_source = CurveSource::Orthogonal;
+    } else {
+        curve_source = CurveSource::Monomial;
+    }
+    curve_coeffs = coeffs;
+    curve_x_min = min_x;
+    curve_x_max = max_x;
+    band_scale = band_dof >= 1.0f ? studentT95((int)band_dof) * std::sqrt(band_rss / band_dof)
+                                  : NAN;
+    describeFit(job);
     
-    for (int i = 0; i < num_curve_points; i++) {
-        float x = min_x + i * step;
-        float y = 0;
-        
-        // Calculate y using the polynomial coefficients
-        for (int j = 0; j <= degree; j++) {
-            y += coeffs(j) * pow(x, j);
-        }
-        
-        curve_points.push_back(Point(x, y));
+#if CURVE_FIT_PROFILE
+    Serial.printf("fit: n=%d degree=%d solve %lu cycles, total %lu us, %lu allocations\n",
+                  n, degree, (unsigned long)solve_cycles, micros() - start_us,
+                  Eigen::allocationCount() - allocs_before);
+    const Eigen::Arena::Stats& arena = solver_arena.stats();
+    Serial.printf("arena: %u of %u bytes, high water %u, %lu resets, %lu overflows, "
+                  "%lu PSRAM fallbacks\n",
+                  (unsigned)solver_arena.used(), (unsigned)solver_arena.capacity(),
+                  (unsigned)arena.high_water, arena.resets, arena.overflows,
+                  Eigen::spiramFallbackCount());
+#endif
+}
+
+// Evaluate the last fit at count points, through the engine that made it
+void CurveFittingUI::evaluateCurve(const float* x, float* y, int count) const {
+    switch (curve_source) {
+        case CurveSource::SmoothingSpline:
+            smoothing_spline_fit.evaluate(x, y, count);
+            break;
+        case CurveSource::BSpline:
+            bspline_fit.evaluate(x, y, count);
+            break;
+        case CurveSource::Ransac:
+            ransac_fit.evaluate(x, y, count);
+            break;
+        case CurveSource::Robust:
+            robust_fit.evaluate(x, y, count);
+            break;
+        case CurveSource::Orthogonal:
+            orthogonal_fit.evaluate(x, y, count, fitted_degree);
+            break;
+        case CurveSource::Monomial:
+            evaluatePolynomial(curve_coeffs.data(), fitted_degree, x, y, count);
+            break;
+        case CurveSource::None:
+            std::fill(y, y + count, NAN);
+            break;
+    }
+}
+
+// Fitted values of the last fit at count points and, in the same pass,
+// their leverage: the variance of each value over sigma^2. False if the
+// fit has no bands.
+bool CurveFittingUI::evaluateLeverage(const float* x, float* y, float* leverage,
+                                      int count) const {
+    switch (curve_source) {
+        case CurveSource::Ransac:
+            ransac_fit.weightedFit().evaluate(x, y, leverage, count, fitted_degree);
+            return true;
+        case CurveSource::Robust:
+            robust_fit.weightedFit().evaluate(x, y, leverage, count, fitted_degree);
+            return true;
+        case CurveSource::Orthogonal:
+            orthogonal_fit.evaluate(x, y, leverage, count, fitted_degree);
+            return true;
+        case CurveSource::Monomial:
+            evaluatePolynomial(curve_coeffs.data(), fitted_degree, x, y, count);
+            curve_covariance.evaluate(x, leverage, count);
+            return true;
+        default:
+            return false;
     }
 }
 
+// Bands of the last fit for a viewport, one entry per plot column the
+// curve crosses. Around a fitted value y with leverage h, the confidence
+// band (where the true curve lies) reaches t * sigma * sqrt(h) to either
+// side and the prediction band (where a new point lies) t * sigma *
+// sqrt(1 + h), with t the 95% quantile of Student's t.
+void CurveFittingUI::computeBands(const Viewport& view, FitBand& confidence,
+                                  FitBand& prediction) {
+    confidence.top.clear();
+    confidence.bottom.clear();
+    prediction.top.clear();
+    prediction.bottom.clear();
+    if (curve_source == CurveSource::None || !std::isfinite(band_scale)) return;
+    
+    PlotMapping mapping = plotMapping(view);
+    float visible_min = std::max(curve_x_min, view.x_min);
+    float visible_max = std::min(curve_x_max, view.x_max);
+    if (!(visible_min <= visible_max)) return;
+    int first = std::max((int)std::ceil(mapping.pixelX(visible_min)), (int)mapping.left);
+    int last = std::min((int)std::floor(mapping.pixelX(visible_max)), (int)mapping.right);
+    if (first > last) return;
+    
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    int count = last - first + 1;
+    band_x.resize(count);
+    band_y.resize(count);
+    band_leverage.resize(count);
+    for (int c = 0; c < count; c++) {
+        band_x[c] = (first + c - mapping.x_offset) / mapping.x_scale;
+    }
+    if (!evaluateLeverage(band_x.data(), band_y.data(), band_leverage.data(), count)) return;
+    
+    confidence.left = first;
+    prediction.left = first;
+    confidence.top.resize(count);
+    confidence.bottom.resize(count);
+    prediction.top.resize(count);
+    prediction.bottom.resize(count);
+    for (int c = 0; c < count; c++) {
+        float leverage = std::max(band_leverage[c], 0.0f);
+        bandRows(mapping, band_y[c], band_scale * std::sqrt(leverage),
+                 confidence.top[c], confidence.bottom[c]);
+        bandRows(mapping, band_y[c], band_scale * std::sqrt(1.0f + leverage),
+                 prediction.top[c], prediction.bottom[c]);
+    }
+#if CURVE_FIT_PROFILE
+    Serial.printf("bands: %d columns, %lu cycles\n", count,
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+}
+
+// Turn the last fit into polylines for a viewport. Samples are spent
+// where the curve bends on screen, not spread evenly over x.
+void CurveFittingUI::tessellateCurve(const Viewport& view,
+                                     CurveTessellator<lv_point_t>& polyline) const {
+    polyline.clear();
+    if (curve_source == CurveSource::None) return;
+    
+    float visible_min = std::max(curve_x_min, view.x_min);
+    float visible_max = std::min(curve_x_max, view.x_max);
+    
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    polyline.tessellate(
+        [this](const float* x, float* y, int count) { evaluateCurve(x, y, count); },
+        visible_min, visible_max, plotMapping(view), CURVE_TOLERANCE, CURVE_INITIAL_SAMPLES);
+#if CURVE_FIT_PROFILE
+    Serial.printf("curve: %d samples, %d segments, %lu cycles\n",
+                  polyline.sampleCount(), polyline.segmentCount(),
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+}
+
+// Body of the fit worker: refit if asked, then tessellate the curve and
+// its bands for the job's viewport. The last tenth of the progress is the tessellation.
+void CurveFittingUI::fit_job_cb(void* context, const FitJob& job, uint32_t id,
+                                FitResult& result) {
+    (void)id;
+    CurveFittingUI *self = (CurveFittingUI*)context;
+    unsigned long start_us = micros();
+    if (job.refit) self->calculatePolynomialFit(job);
+    if (self->fit_worker.cancelled()) return;
+    self->fit_worker.setProgress(0.9f);
+    self->tessellateCurve(job.view, result.polyline);
+    self->computeBands(job.view, result.confidence, result.prediction);
+    
+    result.refit = job.refit;
+    result.view = job.view;
+    result.outliers = self->outliers;
+    memcpy(result.status, self->fit_status, sizeof(result.status));
+    result.fit_ms = (micros() - start_us) * 1e-3f;
+}
+
+// Progress of the robust and RANSAC engines, on the fit worker and the
+// RANSAC helper task; false stops a fit that has been superseded
+bool CurveFittingUI::fit_progress_cb(void* context, float fraction) {
+    CurveFittingUI *self = (CurveFittingUI*)context;
+    self->fit_worker.setProgress(0.9f * fraction);
+    return !self->fit_worker.cancelled();
+}
+
 void CurveFittingUI::update() {
     // No WebSocket updates needed, all computation is done locally
 }
@@ -444,19 +1537,322 @@ void CurveFittingUI::canvas_event_cb(lv_event_t * e) {
         point.x -= lv_obj_get_x(obj);
         point.y -= lv_obj_get_y(obj);
         
+        g_curveFittingUI->gesturePressed(point);
+    } else if (code == LV_EVENT_PRESSING) {
+        g_curveFittingUI->gestureMoved();
+    } else if (code == LV_EVENT_RELEASED || code == LV_EVENT_PRESS_LOST) {
+        g_curveFittingUI->gestureReleased();
+    }
+}
+
+// Touch points on the canvas, in canvas coordinates
+int CurveFittingUI::canvasTouchPoints(lv_point_t* fingers, int max_fingers) {
+    int count = lvgl_port_touch_points(fingers, max_fingers);
+    for (int i = 0; i < count; i++) {
+        fingers[i].x -= lv_obj_get_x(canvas);
+        fingers[i].y -= lv_obj_get_y(canvas);
+    }
+    return count;
+}
+
+void CurveFittingUI::gesturePressed(lv_point_t point) {
+    gesture_press = point;
+    if (live_fit) {
+        livePressed(point);
+    } else {
+        gesture = Gesture::Tap;
+    }
+}
+
+// Measure the pan or pinch from these fingers and the current viewport
+void CurveFittingUI::anchorGesture(const lv_point_t* fingers, int count) {
+    gesture = count >= 2 ? Gesture::Pinch : Gesture::Pan;
+    gesture_anchor[0] = fingers[0];
+    gesture_anchor[1] = fingers[count >= 2 ? 1 : 0];
+    gesture_view = viewport();
+}
+
+void CurveFittingUI::gestureMoved() {
+    if (gesture == Gesture::None) return;
+    
+    lv_point_t fingers[2];
+    int count = canvasTouchPoints(fingers, 2);
+    if (count == 0) return;
+    
+    if (gesture == Gesture::Drag || gesture == Gesture::Stream) {
+        if (count < 2) {
+            liveMoved(fingers[0]);
+            return;
+        }
+        // A second finger turns the live edit into a pinch
+        snapshotFrame();
+        anchorGesture(fingers, count);
+    } else if (gesture == Gesture::Tap) {
+        // Small movement is still a tap
+        if (count < 2 && std::abs(fingers[0].x - gesture_press.x) <= GESTURE_SLOP &&
+            std::abs(fingers[0].y - gesture_press.y) <= GESTURE_SLOP) {
+            return;
+        }
+        snapshotFrame();
+        anchorGesture(fingers, count);
+    } else if ((count >= 2) != (gesture == Gesture::Pinch)) {
+        // A finger was added or lifted: carry on from where the view is
+        anchorGesture(fingers, count);
+    }
+    
+    // The world point under the anchor centroid follows the finger
+    // centroid, and the view scales with the distance between fingers
+    float anchor_x = 0.5f * (gesture_anchor[0].x + gesture_anchor[1].x);
+    float anchor_y = 0.5f * (gesture_anchor[0].y + gesture_anchor[1].y);
+    float center_x = fingers[0].x;
+    float center_y = fingers[0].y;
+    float zoom = 1.0f;
+    if (gesture == Gesture::Pinch) {
+        center_x = 0.5f * (fingers[0].x + fingers[1].x);
+        center_y = 0.5f * (fingers[0].y + fingers[1].y);
+        float anchor_distance = std::hypot((float)(gesture_anchor[1].x - gesture_anchor[0].x),
+                                           (float)(gesture_anchor[1].y - gesture_anchor[0].y));
+        float distance = std::hypot((float)(fingers[1].x - fingers[0].x),
+                                    (float)(fingers[1].y - fingers[0].y));
+        zoom = distance / std::max(anchor_distance, 1.0f);
+        
+        float x_span = gesture_view.x_max - gesture_view.x_min;
+        float y_span = gesture_view.y_max - gesture_view.y_min;
+        zoom = std::min(std::max(zoom, std::max(x_span, y_span) / MAX_VIEW_SPAN),
+                        std::min(x_span, y_span) / MIN_VIEW_SPAN);
+    }
+    
+    PlotMapping from = plotMapping(gesture_view);
+    float world_x = (anchor_x - from.x_offset) / from.x_scale;
+    float world_y = (anchor_y - from.y_offset) / from.y_scale;
+    float x_scale = from.x_scale * zoom;
+    float y_scale = from.y_scale * zoom;
+    Viewport view;
+    view.x_min = world_x + (from.left - center_x) / x_scale;
+    view.x_max = world_x + (from.right - center_x) / x_scale;
+    view.y_min = world_y + (from.bottom - center_y) / y_scale;
+    view.y_max = world_y + (from.top - center_y) / y_scale;
+    setViewport(view);
+    
+    previewViewport();
+    preview_shown = true;
+    lv_timer_reset(settle_timer);
+    lv_timer_resume(settle_timer);
+}
+
+void CurveFittingUI::gestureReleased() {
+    Gesture ended = gesture;
+    gesture = Gesture::None;
+    
+    if (ended == Gesture::Tap) {
         float world_x, world_y;
-        g_curveFittingUI->convertFromCanvasCoords(point.x, point.y, world_x, world_y);
+        convertFromCanvasCoords(gesture_press.x, gesture_press.y, world_x, world_y);
         
         // Add the point if it's within the valid range
-        if (world_x >= g_curveFittingUI->x_min && world_x <= g_curveFittingUI->x_max &&
-            world_y >= g_curveFittingUI->y_min && world_y <= g_curveFittingUI->y_max) {
-            g_curveFittingUI->addPoint(world_x, world_y);
+        if (world_x >= x_min && world_x <= x_max &&
+            world_y >= y_min && world_y <= y_max) {
+            addPoint(world_x, world_y);
             
             char status_text[50];
             sprintf(status_text, "Added point (%.2f, %.2f)", world_x, world_y);
-            g_curveFittingUI->updateStatusText(status_text);
+            updateStatusText(status_text);
+        }
+    } else if (ended == Gesture::Drag || ended == Gesture::Stream) {
+        showFitStatus();
+    } else if (preview_shown) {
+        lv_timer_pause(settle_timer);
+        renderViewport();
+    }
+}
+
+void CurveFittingUI::setLiveFit(bool enabled) {
+    live_fit = enabled;
+    if (!enabled) {
+        lv_obj_add_flag(frame_label, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    lv_label_set_text(frame_label, "Drag a point or draw new ones");
+    lv_obj_clear_flag(frame_label, LV_OBJ_FLAG_HIDDEN);
+    if (points.size() >= 2) plotCurve();
+}
+
+// Grab the nearest point within reach, or start streaming in new ones
+void CurveFittingUI::livePressed(lv_point_t point) {
+    frame_time_us = 0;
+    
+    float best = LIVE_GRAB_RADIUS * LIVE_GRAB_RADIUS;
+    int grabbed = -1;
+    PlotMapping mapping = plotMapping();
+    for (size_t i = 0; i < points.size(); i++) {
+        float dx = mapping.pixelX(points[i].x) - point.x;
+        float dy = mapping.pixelY(points[i].y) - point.y;
+        if (dx * dx + dy * dy < best) {
+            best = dx * dx + dy * dy;
+            grabbed = i;
+        }
+    }
+    if (grabbed >= 0) {
+        // A fit in flight reads the point from the store, where the drag
+        // is about to move it, so it is stopped and asked for again with
+        // the point in the job
+        gesture = Gesture::Drag;
+        live_point = grabbed;
+        if (fit_job > shown_job) {
+            fit_worker.cancelAndWait();
+            submitFit(false);
+        }
+        return;
+    }
+    
+    gesture = Gesture::Stream;
+    live_last = point;
+    float world_x, world_y;
+    convertFromCanvasCoords(point.x, point.y, world_x, world_y);
+    if (world_x >= x_min && world_x <= x_max && world_y >= y_min && world_y <= y_max) {
+        addPoint(world_x, world_y);
+    }
+}
+
+void CurveFittingUI::liveMoved(lv_point_t point) {
+    float world_x, world_y;
+    convertFromCanvasCoords(point.x, point.y, world_x, world_y);
+    
+    if (gesture == Gesture::Stream) {
+        float dx = point.x - live_last.x;
+        float dy = point.y - live_last.y;
+        if (dx * dx + dy * dy < LIVE_STREAM_SPACING * LIVE_STREAM_SPACING) return;
+        live_last = point;
+        if (world_x >= x_min && world_x <= x_max && world_y >= y_min && world_y <= y_max) {
+            addPoint(world_x, world_y);
+        }
+        return;
+    }
+    
+    // Move the dragged point within the viewport, swapping it in the
+    // running sums and the density map
+    Point& moved = points[live_point];
+    PolynomialMoments<MAX_DEGREE>& fold = cv_folds[live_point % CV_FOLDS];
+    bool binned = density_valid && live_point < density_points;
+    moments.remove(moved.x, moved.y);
+    fold.remove(moved.x, moved.y);
+    if (binned) density.remove(moved.x, moved.y);
+    moved.x = std::min(std::max(world_x, x_min), x_max);
+    moved.y = std::min(std::max(world_y, y_min), y_max);
+    moments.add(moved.x, moved.y);
+    fold.add(moved.x, moved.y);
+    if (binned) density.add(moved.x, moved.y);
+    
+    // A series stays one only while the point keeps between its neighbours
+    if (points_sorted) {
+        bool in_order = (live_point == 0 || points[live_point - 1].x <= moved.x) &&
+                        (live_point + 1 == points.size() || moved.x <= points[live_point + 1].x);
+        if (!in_order) {
+            points_sorted = false;
+            envelope.clear();
+        } else if (live_point < envelope.size()) {
+            envelope.update(points.data(), live_point);
+        }
+    }
+    liveFrame();
+}
+
+// Refit after a live edit. The edit is drawn at once, with the curve as
+// it was; the refit is drawn when the worker hands it back, and the
+// readout then shows what the frame cost. Only the tiles the previous
+// frame drew on are restored from the axis layer, so the redraw scales
+// with the points and curve, not the canvas. An edit arriving while the
+// worker is busy waits for it rather than cancelling it, so a slow fit
+// still reaches the screen while the finger moves.
+void CurveFittingUI::liveFrame() {
+    if (points.size() >= 2) submitFit(false);
+    drawPoints();
+}
+
+// Keep the frame on the canvas as the source of the gesture previews
+void CurveFittingUI::snapshotFrame() {
+    if (!frame_snapshot) return;
+    memcpy(frame_snapshot, cbuf, LV_CANVAS_BUF_SIZE_TRUE_COLOR(CANVAS_WIDTH, CANVAS_HEIGHT));
+    snapshot_view = viewport();
+}
+
+// Show the snapshot moved and scaled to the current viewport, inside the
+// axis lines. Nearest-neighbour, so the cost is one gather per pixel
+// however many points and curve segments the frame holds. Ticks and labels
+// stay as they are until the full redraw.
+void CurveFittingUI::previewViewport() {
+    if (!frame_snapshot) return;
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    
+    // Canvas pixel to snapshot pixel, per axis
+    PlotMapping now = plotMapping();
+    PlotMapping then = plotMapping(snapshot_view);
+    float scale_x = then.x_scale / now.x_scale;
+    float shift_x = then.x_offset - now.x_offset * scale_x;
+    float scale_y = then.y_scale / now.y_scale;
+    float shift_y = then.y_offset - now.y_offset * scale_y;
+    
+    int left = (int)now.left + 2;
+    int right = (int)now.right;
+    int top = (int)now.top;
+    int bottom = (int)now.bottom - 2;
+    for (int x = left; x <= right; x++) {
+        int source = (int)std::lround(x * scale_x + shift_x);
+        preview_columns[x] = source >= left && source <= right ? source : -1;
+    }
+    
+    lv_color_t background = lv_color_hex(CANVAS_BG_COLOR);
+    for (int y = top; y <= bottom; y++) {
+        lv_color_t *row = cbuf + y * CANVAS_WIDTH;
+        int source_y = (int)std::lround(y * scale_y + shift_y);
+        if (source_y < top || source_y > bottom) {
+            std::fill(row + left, row + right + 1, background);
+            continue;
+        }
+        const lv_color_t *source_row = frame_snapshot + source_y * CANVAS_WIDTH;
+        for (int x = left; x <= right; x++) {
+            int source = preview_columns[x];
+            row[x] = source >= 0 ? source_row[source] : background;
         }
     }
+    markDrawn(left, top, right, bottom);
+    flushDirtyTiles();
+#if CURVE_FIT_PROFILE
+    Serial.printf("pan: preview %lu cycles\n",
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+}
+
+// Full-quality frame for the current viewport: axis and labels, points,
+// and the curve tessellated again at the new scale
+void CurveFittingUI::renderViewport() {
+#if CURVE_FIT_PROFILE
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+    axis_layer_valid = false;
+    submitRedraw();
+    drawPoints();
+    preview_shown = false;
+    
+    // Further previews of a gesture still under way start from here
+    if (gesture == Gesture::Pan || gesture == Gesture::Pinch) {
+        snapshotFrame();
+    }
+#if CURVE_FIT_PROFILE
+    Serial.printf("pan: render %lu cycles\n",
+                  (unsigned long)(esp_cpu_get_cycle_count() - start_cycles));
+#endif
+}
+
+void CurveFittingUI::settle_timer_cb(lv_timer_t * timer) {
+    lv_timer_pause(timer);
+    g_curveFittingUI->renderViewport();
+}
+
+void CurveFittingUI::fit_timer_cb(lv_timer_t * timer) {
+    (void)timer;
+    g_curveFittingUI->pollFit();
 }
 
 void CurveFittingUI::plot_btn_event_cb(lv_event_t * e) {
@@ -476,11 +1872,54 @@ void CurveFittingUI::degree_dropdown_event_cb(lv_event_t * e) {
         lv_obj_t * dropdown = lv_event_get_target(e);
         int selected = lv_dropdown_get_selected(dropdown);
         
-        // Convert dropdown index to polynomial degree (index + 1)
-        g_curveFittingUI->polynomial_degree = selected + 1;
+        // Convert dropdown index to polynomial degree (index + 1); the
+        // entries after the last degree are "Auto" and the two splines
+        char status_text[50];
+        if (selected == MAX_FIT_DEGREE + 2) {
+            g_curveFittingUI->polynomial_degree = BSPLINE_DEGREE;
+            sprintf(status_text, "Set curve to B-spline");
+        } else if (selected == MAX_FIT_DEGREE + 1) {
+            g_curveFittingUI->polynomial_degree = SMOOTHING_SPLINE_DEGREE;
+            sprintf(status_text, "Set curve to smoothing spline");
+        } else if (selected >= MAX_FIT_DEGREE) {
+            g_curveFittingUI->polynomial_degree = AUTO_DEGREE;
+            sprintf(status_text, "Set degree to Auto");
+        } else {
+            g_curveFittingUI->polynomial_degree = selected + 1;
+            sprintf(status_text, "Set degree to %d", g_curveFittingUI->polynomial_degree);
+        }
+        g_curveFittingUI->updateStatusText(status_text);
         
+        // A live plot follows the setting right away
+        if (g_curveFittingUI->live_fit && g_curveFittingUI->points.size() >= 2) {
+            g_curveFittingUI->plotCurve();
+        }
+    }
+}
+
+void CurveFittingUI::method_dropdown_event_cb(lv_event_t * e) {
+    if (lv_event_get_code(e) == LV_EVENT_VALUE_CHANGED) {
+        lv_obj_t * dropdown = lv_event_get_target(e);
+        int selected = lv_dropdown_get_selected(dropdown);
+        
+        // Dropdown entries are in FitMethod order
+        g_curveFittingUI->fit_method = (FitMethod)selected;
+        
+        char method_text[30];
         char status_text[50];
-        sprintf(status_text, "Set degree to %d", g_curveFittingUI->polynomial_degree);
+        lv_dropdown_get_selected_str(dropdown, method_text, sizeof(method_text));
+        sprintf(status_text, "Set method to %s", method_text);
         g_curveFittingUI->updateStatusText(status_text);
+        
+        if (g_curveFittingUI->live_fit && g_curveFittingUI->points.size() >= 2) {
+            g_curveFittingUI->plotCurve();
+        }
+    }
+}
+
+void CurveFittingUI::live_checkbox_event_cb(lv_event_t * e) {
+    if (lv_event_get_code(e) == LV_EVENT_VALUE_CHANGED) {
+        lv_obj_t * checkbox = lv_event_get_target(e);
+        g_curveFittingUI->setLiveFit(lv_obj_has_state(checkbox, LV_STATE_CHECKED));
     }
 }
\ No newline at end of file
@@ -3,13 +3,27 @@
 #include <lvgl.h>
 #include <vector>
 #include "eigen.cpp"
+#include "polynomial_fit.h"
+#include "polynomial_eval.h"
+#include "orthogonal_fit.h"
+#include "robust_fit.h"
+#include "ransac_fit.h"
+#include "spline_fit.h"
+#include "dirty_tiles.h"
+#include "curve_tessellator.h"
+#include "canvas_raster.h"
+#include "point_decimation.h"
+#include "glyph_atlas.h"
+#include "fit_worker.h"
 #include "lvgl_port_v8.h"
 
 // Colors
 #define CANVAS_BG_COLOR       0x1E1E2E  // Dark modern background
 #define AXIS_COLOR            0x45475A  // Medium gray for axis lines
 #define POINT_COLOR           0xF5C2E7  // Pink for data points
+#define OUTLIER_COLOR         0xFAB387  // Peach for points rejected as outliers
 #define CURVE_COLOR           0x89DCEB  // Cyan for fitted curve
+#define BAND_COLOR            0x89DCEB  // Cyan, shaded, for the fit's bands
 #define SCREEN_BG_COLOR       0x11111B  // Darker background for screen
 #define BUTTON_PLOT_COLOR     0x74C7EC  // Blue for plot button
 #define BUTTON_CLEAR_COLOR    0xB4607E  // Red for clear button
@@ -25,65 +39,458 @@
 #define TOTAL_HEIGHT          480
 
 // Maximum number of points
-#define MAX_POINTS            100
+#define MAX_POINTS            250000
 
-// Point constants
+// The fits that keep per-point buffers (orthogonal basis, robust, RANSAC
+// and the splines) take every k-th point of a larger set, so that their
+// buffers stay below about 1.6 MB instead of the 39 MB MAX_POINTS would
+// need. Least-squares fits of degree up to MAX_DEGREE work from running
+// sums and use every point, but score on the same subset.
+#define MAX_FIT_POINTS        10000
+
+// Up to DOT_POINT_LIMIT points are drawn as dots. Beyond that, a series
+// (points added in order of x, such as a log or a stream) is drawn as its
+// min/max envelope per pixel column, and any other set as a density map
+// of points per pixel.
+#define DOT_POINT_LIMIT       2000
+
+// Highest polynomial degree fitted in the monomial basis
+#define MAX_DEGREE            5
+
+// Solver for the monomial normal equations: MomentSolver::LU (partial
+// pivoting, O(d^3)) or MomentSolver::Hankel (structured, O(d^2))
+#define MOMENT_SOLVER         MomentSolver::LU
+
+// Arithmetic of the monomial solve: MomentPrecision::Float, Mixed (float
+// solve refined against compensated moments) or Double (software double)
+#define MOMENT_PRECISION      MomentPrecision::Mixed
+
+// Highest polynomial degree offered in the dropdown. Degrees above
+// MAX_DEGREE are fitted in an orthogonal basis (see orthogonal_fit.h).
+#define MAX_FIT_DEGREE        20
+
+// Dropdown entry after the numbered degrees: pick the degree automatically
+// from one nested fit up to MAX_FIT_DEGREE, by AUTO_DEGREE_CRITERION
+// (DegreeCriterion::AIC, BIC, AdjustedR2 or LeaveOneOut)
+#define AUTO_DEGREE           0
+#define AUTO_DEGREE_CRITERION DegreeCriterion::AIC
+
+// Dropdown entries after "Auto": a cubic smoothing spline with penalty
+// weight SPLINE_SMOOTHING on the integrated squared second derivative, and
+// a least-squares cubic B-spline over BSPLINE_SEGMENTS equal spans
+#define SMOOTHING_SPLINE_DEGREE (-1)
+#define BSPLINE_DEGREE        (-2)
+#define SPLINE_SMOOTHING      0.1f
+#define BSPLINE_SEGMENTS      8
+
+// Number of folds for the k-fold cross-validation of monomial fits
+#define CV_FOLDS              5
+
+// Iteration limit for the robust (Huber/Tukey) fit methods
+#define ROBUST_MAX_ITERATIONS 20
+
+// RANSAC: points within RANSAC_THRESHOLD (in y units) of a hypothesis are
+// its inliers; the search stops adaptively or after RANSAC_MAX_HYPOTHESES
+#define RANSAC_THRESHOLD      0.3f
+#define RANSAC_MAX_HYPOTHESES 2048
+
+// The second RANSAC worker runs on RANSAC_HELPER_CORE (the LVGL task's)
+// at RANSAC_HELPER_PRIORITY, below the LVGL task's priority of 2, so it
+// only takes time the UI leaves idle. A core of -1 draws every hypothesis
+// on the fit worker.
+#define RANSAC_HELPER_CORE     1
+#define RANSAC_HELPER_PRIORITY 1
+
+// The fitted curve is sampled uniformly at CURVE_INITIAL_SAMPLES points,
+// then refined until it is within CURVE_TOLERANCE pixels of the polyline
+#define CURVE_INITIAL_SAMPLES 32
+#define CURVE_TOLERANCE       0.5f
+
+// Polynomial fits are drawn over two shaded bands: the 95% confidence
+// band of the curve and the wider 95% prediction band of a new point.
+// Each is blended over the plot at the given opacity (out of 32), and 0
+// leaves it out. Splines get no bands.
+#define CONFIDENCE_BAND_ALPHA 8
+#define PREDICTION_BAND_ALPHA 4
+
+// Solver scratch: every fit carves its Matrix/Vector buffers from an
+// arena of SOLVER_ARENA_BYTES placed in SOLVER_MEMORY_TIER and rewinds it
+// afterwards. Buffers that do not fit, and those kept past the fit, go to
+// the heap in SOLVER_HEAP_TIER. That is PSRAM, as per-point buffers of a
+// large set would otherwise drain internal SRAM.
+#define SOLVER_MEMORY_TIER    Eigen::MemoryTier::Internal
+#define SOLVER_HEAP_TIER      Eigen::MemoryTier::Spiram
+#define SOLVER_ARENA_BYTES    16384
+
+// Fits run on a task of their own, pinned to FIT_WORKER_CORE (the core
+// the LVGL task does not run on), and the UI polls for results every
+// FIT_POLL_MS. The LVGL task never waits for a fit.
+#define FIT_WORKER_CORE       0
+#define FIT_WORKER_STACK_SIZE (8 * 1024)
+#define FIT_WORKER_PRIORITY   1
+#define FIT_POLL_MS           15
+
+// Set to 1 to log fit timings and heap traffic over Serial
+#define CURVE_FIT_PROFILE     0
+
+// Pan and pinch-zoom: a touch that moves more than GESTURE_SLOP pixels
+// pans instead of adding a point, and GESTURE_SETTLE_MS without movement
+// brings a full redraw. The viewport span on each axis stays within
+// MIN_VIEW_SPAN..MAX_VIEW_SPAN.
+#define GESTURE_SLOP          8
+#define GESTURE_SETTLE_MS     150
+#define MIN_VIEW_SPAN         0.01f
+#define MAX_VIEW_SPAN         10000.0f
+
+// Live fit: a touch within LIVE_GRAB_RADIUS pixels of a point drags it,
+// anywhere else it streams in a new point every LIVE_STREAM_SPACING pixels
+#define LIVE_GRAB_RADIUS      16
+#define LIVE_STREAM_SPACING   12
+
+// Point and curve constants
 #define POINT_RADIUS          4
+#define CURVE_WIDTH           2
 
 class CurveFittingUI {
 public:
+    typedef Eigen::Vector<float, MAX_DEGREE + 1> Coefficients;
+    
     CurveFittingUI();
     void init();
     void update();
+    
+    // Append count samples at once, such as a captured signal, and redraw
+    // once. Call with the LVGL lock held.
+    void addPoints(const float* x, const float* y, size_t count);
 
 private:
     struct Point {
         float x;
         float y;
+        Point() : x(0.0f), y(0.0f) {}
         Point(float _x, float _y) : x(_x), y(_y) {}
     };
-
+    
+    // Fit methods, in the order of the method dropdown
+    enum class FitMethod {
+        LeastSquares,
+        Huber,
+        Tukey,
+        Ransac
+    };
+    
+    // Engine holding the plotted curve
+    enum class CurveSource {
+        None,
+        Monomial,
+        Orthogonal,
+        Robust,
+        Ransac,
+        SmoothingSpline,
+        BSpline
+    };
+    
+    // Visible world rectangle
+    struct Viewport {
+        float x_min, x_max, y_min, y_max;
+        
+        bool operator==(const Viewport& other) const {
+            return x_min == other.x_min && x_max == other.x_max &&
+                   y_min == other.y_min && y_max == other.y_max;
+        }
+    };
+    
+    // How the points are drawn, see DOT_POINT_LIMIT
+    enum class PointView {
+        Dots,
+        Envelope,
+        Density
+    };
+    
+    // Touch on the canvas: a tap adds a point when released, one moving
+    // finger pans, two fingers pan and zoom. In live fit mode one finger
+    // drags a point or streams in new ones instead.
+    enum class Gesture {
+        None,
+        Tap,
+        Pan,
+        Pinch,
+        Drag,
+        Stream
+    };
+    
+    // Work for the fit worker: fit the first count points with the given
+    // settings and tessellate the curve for the viewport, or (refit false)
+    // only tessellate the last fit again. Points are appended in place, as
+    // the store never reallocates, so the worker reads them there. The one
+    // point a drag keeps moving is the exception: the job carries a copy
+    // of it, point moved (or -1), and the worker reads that instead. A
+    // grab or clear first waits for the worker to let go of older jobs.
+    struct FitJob {
+        bool refit;
+        const Point *points;
+        int count;
+        int moved;
+        Point moved_point;
+        int polynomial_degree;
+        FitMethod fit_method;
+        Viewport view;
+        PolynomialMoments<MAX_DEGREE> moments;
+        PolynomialMoments<MAX_DEGREE> cv_folds[CV_FOLDS];
+    };
+    
+    // A band around the curve as the canvas rows it covers, top[c] to
+    // bottom[c], in each canvas column left + c. Empty columns have top
+    // below bottom.
+    struct FitBand {
+        int left;
+        std::vector<int16_t> top;
+        std::vector<int16_t> bottom;
+    };
+    
+    // What the worker hands back: the curve as polylines for the viewport
+    // and its bands, the points the fit rejected, its status text and the
+    // time it took
+    struct FitResult {
+        bool refit;
+        Viewport view;
+        CurveTessellator<lv_point_t> polyline;
+        FitBand confidence;
+        FitBand prediction;
+        std::vector<bool> outliers;
+        char status[160];
+        float fit_ms;
+    };
+    
     // UI elements
     lv_obj_t *canvas;
     lv_color_t *cbuf;
+    
+    // Draws the points and curve straight into cbuf
+    CanvasRaster raster;
+    
+    // Background and axis, rendered once per viewport into its own buffer
+    // and copied under the points and curve on every full redraw
+    lv_color_t *axis_layer;
+    bool axis_layer_valid;
+    
+    // Glyphs of the tick labels, rendered once with the label font
+    GlyphAtlas glyph_atlas;
+    
+    // Canvas tiles written since the last flush to the display, and tiles
+    // that differ from the axis layer (the points and curve drawn on it)
+    TileMask<CANVAS_WIDTH, CANVAS_HEIGHT> dirty_tiles;
+    TileMask<CANVAS_WIDTH, CANVAS_HEIGHT> content_tiles;
     lv_obj_t *sidebar;
     lv_obj_t *degree_dropdown;
+    lv_obj_t *method_dropdown;
     lv_obj_t *plot_btn;
     lv_obj_t *clear_btn;
     lv_obj_t *status_label;
+    lv_obj_t *live_checkbox;
+    lv_obj_t *frame_label;
     
-    // Data points and curve
+    // Data points
     std::vector<Point> points;
-    std::vector<Point> curve_points;
     
-    // Selected polynomial degree
+    // Whether the points are in order of x, so they form a series; the
+    // min/max levels over them while they are; and the density map with
+    // the viewport it was binned for and how many points it holds
+    bool points_sorted;
+    SeriesEnvelope<Point> envelope;
+    DensityGrid density;
+    Viewport density_view;
+    bool density_valid;
+    size_t density_points;
+    
+    // Power sums of the points, updated on every add/clear
+    PolynomialMoments<MAX_DEGREE> moments;
+    
+    // The same sums split into CV_FOLDS folds by insertion order, so
+    // k-fold cross-validation needs no pass over the points
+    PolynomialMoments<MAX_DEGREE> cv_folds[CV_FOLDS];
+    
+    // Selected fit method and polynomial degree (AUTO_DEGREE for automatic
+    // selection, or one of the spline entries)
+    FitMethod fit_method;
     int polynomial_degree;
     
+    // From here to fit_worker, everything belongs to the fit worker task
+    // and is never touched by the LVGL task.
+    //
+    // Scratch for the fitting engines below, rewound after every fit.
+    // Declared first so it outlives their buffers.
+    Eigen::Arena solver_arena;
+    
+    // Fitting engine for degrees above MAX_DEGREE
+    OrthogonalPolynomialFit<MAX_FIT_DEGREE> orthogonal_fit;
+    
+    // Outlier-resistant fit, used by the Huber and Tukey methods
+    RobustPolynomialFit<MAX_FIT_DEGREE> robust_fit;
+    
+    // Random sample consensus fit for gross outliers, up to MAX_DEGREE
+    RansacPolynomialFit<MAX_DEGREE> ransac_fit;
+    
+    // Points the last fit rejected as outliers, drawn in OUTLIER_COLOR
+    std::vector<bool> outliers;
+    
+    // The points the per-point engines fit when there are more than
+    // MAX_FIT_POINTS, every fit_stride-th one, or when a job carries a
+    // moved point. The stride shares no factor with CV_FOLDS, so the
+    // subset samples every fold.
+    std::vector<Point> fit_subset;
+    int fit_stride;
+    
+    // Spline engines for the two spline entries of the degree dropdown
+    SmoothingSpline smoothing_spline_fit;
+    BSplineFit bspline_fit;
+    
+    // Degree of the curve plotted
+    int fitted_degree;
+    
+    // Cross-validated RMSE of the last fit (NAN if unavailable) and
+    // whether it is leave-one-out or k-fold
+    float cv_rmse;
+    bool cv_leave_one_out;
+    
+    // The plotted curve: where to evaluate it (the engine, monomial
+    // coefficients and degree) over which x range, and what to say about it
+    CurveSource curve_source;
+    Coefficients curve_coeffs;
+    float curve_x_min, curve_x_max;
+    char fit_status[160];
+    
+    // The bands of the plotted curve: the covariance of a monomial fit
+    // (the others are orthonormal), and the 95% half-width of the
+    // confidence band per unit of root leverage, t * sigma, or NAN for no
+    // bands. Then one sample of the curve and its leverage per column.
+    PolynomialCovariance<MAX_DEGREE> curve_covariance;
+    float band_scale;
+    std::vector<float> band_x;
+    std::vector<float> band_y;
+    std::vector<float> band_leverage;
+    
+    // Runs the fits. The last result taken from it is the curve on screen
+    // (nullptr if none), from job shown_job. fit_job is the last refit
+    // asked for, outstanding while it is above shown_job. Results of jobs
+    // before fit_epoch predate a clear and are dropped. The poll timer
+    // takes results and shows the progress of a refit, as a percentage.
+    FitWorker<FitJob, FitResult> fit_worker;
+    const FitResult *fit;
+    uint32_t fit_job;
+    uint32_t shown_job;
+    uint32_t fit_epoch;
+    lv_timer_t *fit_timer;
+    int fit_progress;
+    
     // Canvas coordinate transformation
     float x_min, x_max, y_min, y_max;
     bool axis_initialized;
     
+    // Gesture in progress: where the touch went down, and the fingers and
+    // viewport the current pan or pinch is measured from
+    Gesture gesture;
+    lv_point_t gesture_press;
+    lv_point_t gesture_anchor[2];
+    Viewport gesture_view;
+    
+    // Copy of the last full redraw and its viewport. While a gesture
+    // moves, the plot area shows this frame shifted and scaled, and the
+    // settle timer brings the full redraw once it pauses or ends.
+    lv_color_t *frame_snapshot;
+    Viewport snapshot_view;
+    lv_timer_t *settle_timer;
+    bool preview_shown;
+    
+    // Live fit mode, the point being dragged and where the last streamed
+    // point went
+    bool live_fit;
+    size_t live_point;
+    lv_point_t live_last;
+    
+    // Smoothed cost of a live frame (refit with tessellation on the
+    // worker, redraw of the dirty tiles) and time between frames, in
+    // milliseconds
+    float frame_fit_ms;
+    float frame_draw_ms;
+    float frame_period_ms;
+    unsigned long frame_time_us;
+    
+    // Snapshot column shown in each canvas column of the preview, or -1
+    int16_t preview_columns[CANVAS_WIDTH];
+    
     // UI methods
     void createUI();
     void drawAxis();
+    void renderAxisLayer();
+    void buildGlyphAtlas();
+    void drawLabel(int x, int y, int max_width, lv_text_align_t align, const char* text);
+    void drawPoint(size_t index);
     void drawPoints();
+    void drawEnvelope();
+    void drawDensity();
+    PointView pointView() const;
     void drawCurve();
+    void drawBands();
+    void markDrawn(int x0, int y0, int x1, int y1);
+    void markDrawnLine(int x0, int y0, int x1, int y1, int pad);
+    void flushDirtyTiles();
     void clearCanvas();
     void convertToCanvasCoords(float x, float y, int& canvas_x, int& canvas_y);
+    PlotMapping plotMapping() const;
+    PlotMapping plotMapping(const Viewport& view) const;
+    Viewport viewport() const;
+    void setViewport(const Viewport& view);
     void convertFromCanvasCoords(int canvas_x, int canvas_y, float& x, float& y);
     void updateStatusText(const char* text);
     
+    // Pan and pinch-zoom
+    void gesturePressed(lv_point_t point);
+    void gestureMoved();
+    void gestureReleased();
+    void anchorGesture(const lv_point_t* fingers, int count);
+    void snapshotFrame();
+    void previewViewport();
+    void renderViewport();
+    int canvasTouchPoints(lv_point_t* fingers, int max_fingers);
+    
+    // Live fit
+    void setLiveFit(bool enabled);
+    void livePressed(lv_point_t point);
+    void liveMoved(lv_point_t point);
+    void liveFrame();
+    
     // Curve fitting methods
     void addPoint(float x, float y);
+    void appendPoint(float x, float y);
+    void resetPoints();
     void plotCurve();
+    void showFitStatus();
     void clearPoints();
-    void calculatePolynomialFit();
+    void submitFit(bool cancel_running);
+    void submitRedraw();
+    void pollFit();
+    void showFit(const FitResult* result, uint32_t id);
+    
+    // On the fit worker
+    void calculatePolynomialFit(const FitJob& job);
+    void describeFit(const FitJob& job);
+    void evaluateCurve(const float* x, float* y, int count) const;
+    bool evaluateLeverage(const float* x, float* y, float* leverage, int count) const;
+    void computeBands(const Viewport& view, FitBand& confidence, FitBand& prediction);
+    void tessellateCurve(const Viewport& view, CurveTessellator<lv_point_t>& polyline) const;
     
     // Static event handlers
     static void canvas_event_cb(lv_event_t * e);
+    static void settle_timer_cb(lv_timer_t * timer);
+    static void fit_timer_cb(lv_timer_t * timer);
+    static void fit_job_cb(void* context, const FitJob& job, uint32_t id, FitResult& result);
+    static bool fit_progress_cb(void* context, float fraction);
     static void plot_btn_event_cb(lv_event_t * e);
     static void clear_btn_event_cb(lv_event_t * e);
     static void degree_dropdown_event_cb(lv_event_t * e);
+    static void method_dropdown_event_cb(lv_event_t * e);
+    static void live_checkbox_event_cb(lv_event_t * e);
 };
 
 extern CurveFittingUI* g_curveFittingUI;
\ No newline at end of file
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Affine map from world coordinates to canvas pixels, and the pixel
+// rectangle curves are clipped to. Canvas y grows downwards, so y_scale
+// is negative for the usual orientation.
+struct PlotMapping {
+    float x_scale;
+    float x_offset;
+    float y_scale;
+    float y_offset;
+    
+    // Clip rectangle in pixels, inclusive
+    float left;
+    float top;
+    float right;
+    float bottom;
+    
+    float pixelX(float x) const { return x * x_scale + x_offset; }
+    float pixelY(float y) const { return y * y_scale + y_offset; }
+};
+
+// Adaptive tessellation of the graph of y = f(x) into canvas polylines.
+//
+// A uniform pass of initial samples is refined level by level: a segment
+// whose midpoint lies more than the tolerance (in pixels) off its chord
+// is split in two, until every segment is flat to within the tolerance or
+// at most a pixel wide. Each level evaluates all of its new midpoints in
+// one call, so the batch evaluators still get whole arrays. Flat stretches
+// end up as a few long segments and steep ones are followed closely.
+// Above and below the plot only the crossing into view is refined, since
+// y is clamped to just outside the clip rectangle for the flatness test.
+//
+// The result is clipped to the plot rectangle and split into runs: one
+// polyline per stretch of the curve that stays in view. PointT is any
+// struct with integer x and y members, such as lv_point_t. The buffers
+// are kept between calls.
+template<typename PointT>
+class CurveTessellator {
+public:
+    CurveTessellator() : samples_(0) {}
+    
+    // Tessellate f over [x0, x1], where evaluate(x, y, count) sets
+    // y[i] = f(x[i])
+    template<typename Evaluate>
+    void tessellate(Evaluate evaluate, float x0, float x1, const PlotMapping& mapping,
+                    float tolerance = 0.5f, int initial_samples = 32) {
+        clear();
+        if (!(x1 > x0)) return;
+        initial_samples = std::max(initial_samples, 2);
+        
+        // Uniform first pass; every segment is a candidate for refinement
+        x_.resize(initial_samples);
+        y_.resize(initial_samples);
+        float step = (x1 - x0) / (initial_samples - 1);
+        for (int i = 0; i < initial_samples; i++) {
+            x_[i] = x0 + i * step;
+        }
+        x_[initial_samples - 1] = x1;
+        evaluate(x_.data(), y_.data(), initial_samples);
+        samples_ = initial_samples;
+        refine_.assign(initial_samples - 1, 1);
+        
+        for (int level = 0; level < kMaxLevels; level++) {
+            // Midpoints of the segments still marked, in one batch
+            mid_x_.clear();
+            int segments = (int)x_.size() - 1;
+            for (int i = 0; i < segments; i++) {
+                if (!refine_[i]) continue;
+                if (std::fabs(mapping.pixelX(x_[i + 1]) - mapping.pixelX(x_[i])) <= 1.0f) {
+                    refine_[i] = 0;
+                    continue;
+                }
+                mid_x_.push_back(0.5f * (x_[i] + x_[i + 1]));
+            }
+            if (mid_x_.empty()) break;
+            mid_y_.resize(mid_x_.size());
+            evaluate(mid_x_.data(), mid_y_.data(), (int)mid_x_.size());
+            samples_ += (int)mid_x_.size();
+            
+            // Keep the midpoints that are off their chord and mark both
+            // halves for the next level
+            next_x_.clear();
+            next_y_.clear();
+            next_refine_.clear();
+            int m = 0;
+            for (int i = 0; i < segments; i++) {
+                next_x_.push_back(x_[i]);
+                next_y_.push_back(y_[i]);
+                if (!refine_[i]) {
+                    next_refine_.push_back(0);
+                    continue;
+                }
+                float ya = clampedPixelY(mapping, y_[i]);
+                float yb = clampedPixelY(mapping, y_[i + 1]);
+                float ym = clampedPixelY(mapping, mid_y_[m]);
+                if (std::fabs(ym - 0.5f * (ya + yb)) > tolerance) {
+                    next_x_.push_back(mid_x_[m]);
+                    next_y_.push_back(mid_y_[m]);
+                    next_refine_.push_back(1);
+                    next_refine_.push_back(1);
+                } else {
+                    next_refine_.push_back(0);
+                }
+                m++;
+            }
+            next_x_.push_back(x_[segments]);
+            next_y_.push_back(y_[segments]);
+            x_.swap(next_x_);
+            y_.swap(next_y_);
+            refine_.swap(next_refine_);
+        }
+        
+        emitRuns(mapping, tolerance);
+    }
+    
+    void clear() {
+        points_.clear();
+        run_starts_.clear();
+        samples_ = 0;
+    }
+    
+    bool empty() const { return run_starts_.empty(); }
+    
+    // Visible polylines of the last tessellation
+    int runCount() const { return (int)run_starts_.size(); }
+    const PointT* run(int r) const { return points_.data() + run_starts_[r]; }
+    int runLength(int r) const {
+        int end = r + 1 < runCount() ? run_starts_[r + 1] : (int)points_.size();
+        return end - run_starts_[r];
+    }
+    
+    // Line segments drawn and function values computed by the last call
+    int segmentCount() const { return (int)points_.size() - runCount(); }
+    int sampleCount() const { return samples_; }
+    
+private:
+    // Refinement depth limit; 32 initial samples reach 1/32768 of the range
+    static const int kMaxLevels = 10;
+    
+    // Longest stretch of points merged into one segment
+    static const int kMaxMerged = 64;
+    
+    // Pixels beyond the clip rectangle that still count for flatness
+    static constexpr float kClampMargin = 2.0f;
+    
+    static float clampedPixelY(const PlotMapping& mapping, float y) {
+        float py = mapping.pixelY(y);
+        if (std::isnan(py)) return mapping.bottom + kClampMargin;
+        return std::min(std::max(py, mapping.top - kClampMargin),
+                        mapping.bottom + kClampMargin);
+    }
+    
+    // Clip each segment to the plot rectangle (Liang-Barsky) and join the
+    // visible pieces into runs, starting a new run wherever the curve
+    // leaves the rectangle. Points in line with their neighbours are
+    // merged away, as long as every point merged since the last one kept
+    // stays within the tolerance of the longer segment. Merging works on
+    // the exact pixel positions; they are rounded only at the end.
+    void emitRuns(const PlotMapping& mapping, float tolerance) {
+        run_x_.clear();
+        run_y_.clear();
+        bool open = false;
+        int segments = (int)x_.size() - 1;
+        for (int i = 0; i < segments; i++) {
+            float ax = mapping.pixelX(x_[i]);
+            float ay = mapping.pixelY(y_[i]);
+            float bx = mapping.pixelX(x_[i + 1]);
+            float by = mapping.pixelY(y_[i + 1]);
+            float t0 = 0.0f;
+            float t1 = 1.0f;
+            if (!std::isfinite(ay) || !std::isfinite(by) ||
+                !clip(ax - mapping.left, bx - ax, t0, t1) ||
+                !clip(mapping.right - ax, ax - bx, t0, t1) ||
+                !clip(ay - mapping.top, by - ay, t0, t1) ||
+                !clip(mapping.bottom - ay, ay - by, t0, t1)) {
+                open = false;
+                continue;
+            }
+            
+            if (!open || t0 > 0.0f) {
+                finishRun();
+                run_x_.push_back(ax + t0 * (bx - ax));
+                run_y_.push_back(ay + t0 * (by - ay));
+                merged_x_.clear();
+                merged_y_.clear();
+            }
+            append(ax + t1 * (bx - ax), ay + t1 * (by - ay), tolerance);
+            open = t1 >= 1.0f;
+        }
+        finishRun();
+    }
+    
+    // Clip parameter range [t0, t1] to the half-plane distance + t * delta >= 0
+    static bool clip(float distance, float delta, float& t0, float& t1) {
+        if (delta == 0.0f) return distance >= 0.0f;
+        float t = -distance / delta;
+        if (delta > 0.0f) {
+            t0 = std::max(t0, t);
+        } else {
+            t1 = std::min(t1, t);
+        }
+        return t0 <= t1;
+    }
+    
+    // Add (x, y) to the open run, replacing its last point if that and
+    // the points it replaced all lie within the tolerance of the new
+    // segment
+    void append(float x, float y, float tolerance) {
+        int count = (int)run_x_.size();
+        if (count >= 2 && (int)merged_x_.size() < kMaxMerged) {
+            float anchor_x = run_x_[count - 2];
+            float anchor_y = run_y_[count - 2];
+            merged_x_.push_back(run_x_[count - 1]);
+            merged_y_.push_back(run_y_[count - 1]);
+            bool in_line = true;
+            for (size_t k = 0; k < merged_x_.size(); k++) {
+                if (distanceToSegment(merged_x_[k], merged_y_[k], anchor_x, anchor_y, x, y) >
+                    tolerance) {
+                    in_line = false;
+                    break;
+                }
+            }
+            if (in_line) {
+                run_x_[count - 1] = x;
+                run_y_[count - 1] = y;
+                return;
+            }
+            merged_x_.clear();
+            merged_y_.clear();
+        }
+        run_x_.push_back(x);
+        run_y_.push_back(y);
+    }
+    
+    static float distanceToSegment(float px, float py, float ax, float ay, float bx, float by) {
+        float vx = bx - ax;
+        float vy = by - ay;
+        float wx = px - ax;
+        float wy = py - ay;
+        float length_sq = vx * vx + vy * vy;
+        float t = length_sq > 0.0f ? std::min(std::max((wx * vx + wy * vy) / length_sq, 0.0f), 1.0f)
+                                   : 0.0f;
+        float dx = wx - t * vx;
+        float dy = wy - t * vy;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+    
+    // Round the open run to pixels and add it to the output, unless it
+    // collapses to a single pixel
+    void finishRun() {
+        int start = (int)points_.size();
+        for (size_t k = 0; k < run_x_.size(); k++) {
+            PointT point;
+            point.x = (decltype(point.x))std::lround(run_x_[k]);
+            point.y = (decltype(point.y))std::lround(run_y_[k]);
+            if ((int)points_.size() > start && points_.back().x == point.x &&
+                points_.back().y == point.y) {
+                continue;
+            }
+            points_.push_back(point);
+        }
+        if ((int)points_.size() - start >= 2) {
+            run_starts_.push_back(start);
+        } else {
+            points_.resize(start);
+        }
+        run_x_.clear();
+        run_y_.clear();
+    }
+    
+    int samples_;
+    
+    // Samples of the current level, sorted by x, and which of the
+    // segments between them still need refining
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<char> refine_;
+    
+    // Midpoints of one level and the next level being assembled
+    std::vector<float> mid_x_;
+    std::vector<float> mid_y_;
+    std::vector<float> next_x_;
+    std::vector<float> next_y_;
+    std::vector<char> next_refine_;
+    
+    // Output polylines, back to back, and where each run starts
+    std::vector<PointT> points_;
+    std::vector<int> run_starts_;
+    
+    // The run being assembled, in exact pixel positions, and the points
+    // merged into its last segment
+    std::vector<float> run_x_;
+    std::vector<float> run_y_;
+    std::vector<float> merged_x_;
+    std::vector<float> merged_y_;
+};
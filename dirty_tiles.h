@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+
+// Set of the TileSize x TileSize tiles of a Width x Height canvas that a
+// frame has touched, one bit per tile. Drawing code marks the pixel
+// rectangles it writes; the owner then hands the marked region to the
+// display as a few merged rectangles instead of invalidating the whole
+// canvas. Everything is stored inline, so marking never allocates.
+template<int Width, int Height, int TileSize = 16>
+class TileMask {
+public:
+    static constexpr int kTileSize = TileSize;
+    static constexpr int kColumns = (Width + TileSize - 1) / TileSize;
+    static constexpr int kRows = (Height + TileSize - 1) / TileSize;
+    static_assert(kColumns <= 64, "One 64-bit word per tile row");
+    
+    TileMask() {
+        clear();
+    }
+    
+    void clear() {
+        std::fill(rows_, rows_ + kRows, uint64_t(0));
+    }
+    
+    void markAll() {
+        const uint64_t full = kColumns == 64 ? ~uint64_t(0) : (uint64_t(1) << kColumns) - 1;
+        std::fill(rows_, rows_ + kRows, full);
+    }
+    
+    bool empty() const {
+        for (int r = 0; r < kRows; r++) {
+            if (rows_[r]) return false;
+        }
+        return true;
+    }
+    
+    // Mark the tiles under pixels x0..x1, y0..y1 (inclusive, any order),
+    // clipped to the canvas
+    void mark(int x0, int y0, int x1, int y1) {
+        if (x0 > x1) std::swap(x0, x1);
+        if (y0 > y1) std::swap(y0, y1);
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, Width - 1);
+        y1 = std::min(y1, Height - 1);
+        if (x0 > x1 || y0 > y1) return;
+        
+        int c0 = x0 / TileSize;
+        int c1 = x1 / TileSize;
+        uint64_t bits = (c1 - c0 == 63 ? ~uint64_t(0) : ((uint64_t(1) << (c1 - c0 + 1)) - 1)) << c0;
+        for (int r = y0 / TileSize; r <= y1 / TileSize; r++) {
+            rows_[r] |= bits;
+        }
+    }
+    
+    TileMask& operator|=(const TileMask& other) {
+        for (int r = 0; r < kRows; r++) {
+            rows_[r] |= other.rows_[r];
+        }
+        return *this;
+    }
+    
+    // Call f(x, y, width, height) for a set of pixel rectangles that
+    // exactly covers the marked tiles: horizontal runs of tiles, each
+    // extended down over the rows that contain the same run
+    template<typename F>
+    void forEachRect(F f) const {
+        uint64_t remaining[kRows];
+        std::copy(rows_, rows_ + kRows, remaining);
+        for (int r = 0; r < kRows; r++) {
+            while (remaining[r]) {
+                int c0 = __builtin_ctzll(remaining[r]);
+                uint64_t shifted = ~(remaining[r] >> c0);
+                int length = shifted ? __builtin_ctzll(shifted) : 64 - c0;
+                uint64_t run = (length == 64 ? ~uint64_t(0) : ((uint64_t(1) << length) - 1)) << c0;
+                
+                int r1 = r;
+                while (r1 + 1 < kRows && (remaining[r1 + 1] & run) == run) {
+                    r1++;
+                }
+                for (int k = r; k <= r1; k++) {
+                    remaining[k] &= ~run;
+                }
+                
+                int x = c0 * TileSize;
+                int y = r * TileSize;
+                f(x, y, std::min((c0 + length) * TileSize, Width) - x,
+                  std::min((r1 + 1) * TileSize, Height) - y);
+            }
+        }
+    }
+
+private:
+    uint64_t rows_[kRows];
+};
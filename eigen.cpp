@@ -1,59 +1,374 @@
 #pragma once
 
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#endif
+
+// Host SIMD for the float kernels; the ESP32-S3 has no float vector lanes
+#if defined(__AVX__)
+#include <immintrin.h>
+#define EIGEN_VECTORIZE_AVX 1
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define EIGEN_VECTORIZE_SSE 1
+#endif
 
 namespace Eigen {
 
+// Marks a dimension that is only known at runtime
+const int Dynamic = -1;
+
 // Forward declarations
-template<typename T>
+template<typename T, int Rows = Dynamic, int Cols = Dynamic>
 class Matrix;
 
-template<typename T>
+template<typename T, int Size = Dynamic>
 class Vector;
 
+template<typename T>
+class Transpose;
+
 typedef Matrix<float> MatrixXf;
 typedef Vector<float> VectorXf;
 
+// Force unrolling of loops with compile-time bounds, also under -Os
+#if defined(__clang__)
+#define EIGEN_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define EIGEN_UNROLL _Pragma("GCC unroll 16")
+#else
+#define EIGEN_UNROLL
+#endif
+
+// Tag for constructors that skip zero-filling the new buffer
+enum UninitializedTag { Uninitialized };
+
+// Where heap buffers are placed. On the ESP32-S3 Internal is the on-chip
+// SRAM and Spiram the external PSRAM, which is several times slower and
+// shared with the frame buffers; elsewhere every tier is the plain heap.
+enum class MemoryTier {
+    Default,    // Wherever malloc() puts it (PSRAM for large blocks)
+    Internal,   // Internal SRAM, falling back to PSRAM when it runs out
+    Spiram      // External PSRAM
+};
+
+namespace internal {
+
+// Heap traffic of all Matrix/Vector buffers, for checking that a code path
+// reuses its storage instead of allocating
+struct AllocationStats {
+    unsigned long allocations;
+    unsigned long deallocations;
+    unsigned long spiram_fallbacks;   // Internal requests served from PSRAM
+};
+
+inline AllocationStats& allocationStats() {
+    static AllocationStats stats = {0, 0, 0};
+    return stats;
+}
+
+inline MemoryTier& heapTier() {
+    static MemoryTier tier = MemoryTier::Default;
+    return tier;
+}
+
+inline void* heapAllocate(size_t bytes, MemoryTier tier) {
+#if defined(ESP_PLATFORM)
+    const uint32_t caps = MALLOC_CAP_8BIT;
+    switch (tier) {
+        case MemoryTier::Internal: {
+            void* block = heap_caps_malloc(bytes, caps | MALLOC_CAP_INTERNAL);
+            if (block) return block;
+            allocationStats().spiram_fallbacks++;
+            return heap_caps_malloc(bytes, caps | MALLOC_CAP_SPIRAM);
+        }
+        case MemoryTier::Spiram: {
+            void* block = heap_caps_malloc(bytes, caps | MALLOC_CAP_SPIRAM);
+            return block ? block : heap_caps_malloc(bytes, caps);
+        }
+        default:
+            return heap_caps_malloc(bytes, caps);
+    }
+#else
+    (void)tier;
+    return std::malloc(bytes);
+#endif
+}
+
+inline void heapFree(void* block) {
+#if defined(ESP_PLATFORM)
+    heap_caps_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+} // namespace internal
+
+// Tier for Matrix/Vector buffers allocated outside an arena
+inline void setMemoryTier(MemoryTier tier) {
+    internal::heapTier() = tier;
+}
+
+// Bump allocator for solver scratch. While an ArenaScope is open on a
+// thread, the Matrix/Vector buffers allocated there are carved from the
+// arena, and freeing them costs nothing. Closing the scope rewinds the
+// arena in one step.
+//
+// Buffers still held when the arena is rewound go stale: their contents
+// must not be read afterwards, and the next resize() of their owner takes
+// a fresh buffer whatever its capacity. Workspaces that the fitting
+// engines keep between fits simply refill on the next fit that way. The
+// arena must outlive every Matrix/Vector that took a buffer from it.
+//
+// Buffers that do not fit go to the heap, counted as overflows.
+class Arena {
+public:
+    struct Stats {
+        size_t high_water;        // Most bytes in use within one scope
+        unsigned long resets;     // Rewinds, one per closed scope
+        unsigned long overflows;  // Buffers that went to the heap instead
+    };
+    
+    // Reserve capacity bytes in the given tier, up front
+    explicit Arena(size_t capacity, MemoryTier tier = MemoryTier::Internal)
+        : buffer_((unsigned char*)internal::heapAllocate(capacity, tier)),
+          capacity_(buffer_ ? capacity : 0), used_(0), generation_(0),
+          stats_{0, 0, 0} {}
+    
+    ~Arena() {
+        internal::heapFree(buffer_);
+    }
+    
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    
+    // Aligned block of the given size, or nullptr if the arena is full
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t offset = (used_ + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes > capacity_) {
+            stats_.overflows++;
+            return nullptr;
+        }
+        used_ = offset + bytes;
+        stats_.high_water = std::max(stats_.high_water, used_);
+        return buffer_ + offset;
+    }
+    
+    // Release everything at once, making all outstanding buffers stale
+    void reset() {
+        used_ = 0;
+        generation_++;
+        stats_.resets++;
+    }
+    
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return used_; }
+    unsigned long generation() const { return generation_; }
+    const Stats& stats() const { return stats_; }
+    
+private:
+    unsigned char* buffer_;
+    size_t capacity_;
+    size_t used_;
+    unsigned long generation_;
+    Stats stats_;
+};
+
+// Routes the Matrix/Vector allocations of the calling thread to an arena
+// and rewinds it when the scope closes. An inner scope on another arena
+// takes over until it closes; one on the same arena leaves it alone.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : arena_(arena), previous_(current()) {
+        current() = &arena;
+    }
+    
+    ~ArenaScope() {
+        current() = previous_;
+        if (previous_ != &arena_) arena_.reset();
+    }
+    
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+    
+    // Arena of the innermost open scope on this thread, if any
+    static Arena*& current() {
+        static thread_local Arena* arena = nullptr;
+        return arena;
+    }
+    
+private:
+    Arena& arena_;
+    Arena* previous_;
+};
+
+// Routes the Matrix/Vector allocations of the calling thread to the heap
+// while open, also within an ArenaScope. For buffers that must outlive
+// the scope, such as the state an engine is evaluated from after its fit.
+class HeapScope {
+public:
+    HeapScope() : previous_(ArenaScope::current()) {
+        ArenaScope::current() = nullptr;
+    }
+    
+    ~HeapScope() {
+        ArenaScope::current() = previous_;
+    }
+    
+    HeapScope(const HeapScope&) = delete;
+    HeapScope& operator=(const HeapScope&) = delete;
+    
+private:
+    Arena* previous_;
+};
+
+namespace internal {
+
+// Every tier is out of memory. A Matrix/Vector has no way to report it and
+// would write through the null buffer, so stop with a message instead.
+[[noreturn]] inline void allocationFailed(size_t bytes) {
+    std::fprintf(stderr, "Eigen: out of memory allocating %u bytes\n", (unsigned)bytes);
+    std::abort();
+}
+
+// Where a Matrix/Vector buffer came from: an arena and the generation it
+// was carved in, or the heap (no arena)
+struct BufferSource {
+    Arena* arena;
+    unsigned long generation;
+};
+
+const BufferSource kHeapBuffer = {nullptr, 0};
+
+template<typename T>
+T* allocate(int size, BufferSource& source) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Matrix/Vector buffers hold plain numbers");
+    source = kHeapBuffer;
+    if (size <= 0) return nullptr;
+    
+    Arena* arena = ArenaScope::current();
+    if (arena) {
+        void* block = arena->allocate(size * sizeof(T), alignof(T));
+        if (block) {
+            source = {arena, arena->generation()};
+            return (T*)block;
+        }
+    }
+    allocationStats().allocations++;
+    T* data = (T*)heapAllocate(size * sizeof(T), heapTier());
+    if (!data) allocationFailed(size * sizeof(T));
+    return data;
+}
+
+template<typename T>
+void deallocate(T* data, const BufferSource& source) {
+    if (!data || source.arena) return;
+    allocationStats().deallocations++;
+    heapFree(data);
+}
+
+// Whether the buffer's arena has been rewound since it was carved
+inline bool isStale(const BufferSource& source) {
+    return source.arena && source.arena->generation() != source.generation;
+}
+
+} // namespace internal
+
+// Number of Matrix/Vector buffers allocated on the heap since startup.
+// Arena buffers are not counted; see Arena::stats().
+inline unsigned long allocationCount() {
+    return internal::allocationStats().allocations;
+}
+
+// Number of Internal-tier heap blocks (arenas included) that had to be
+// placed in PSRAM because internal SRAM was exhausted
+inline unsigned long spiramFallbackCount() {
+    return internal::allocationStats().spiram_fallbacks;
+}
+
 // Simple matrix implementation for polynomial fitting
 template<typename T>
-class Matrix {
+class Matrix<T, Dynamic, Dynamic> {
 public:
-    Matrix() : rows_(0), cols_(0), data_(nullptr) {}
+    Matrix() : rows_(0), cols_(0), capacity_(0), data_(nullptr), source_(internal::kHeapBuffer) {}
     
-    Matrix(int rows, int cols) : rows_(rows), cols_(cols) {
-        data_ = new T[rows * cols];
-        for (int i = 0; i < rows * cols; i++) {
-            data_[i] = T(0);
-        }
+    Matrix(int rows, int cols) : Matrix(rows, cols, Uninitialized) {
+        std::fill(data_, data_ + size(), T(0));
     }
     
+    Matrix(int rows, int cols, UninitializedTag)
+        : rows_(rows), cols_(cols), capacity_(rows * cols),
+          data_(internal::allocate<T>(rows * cols, source_)) {}
+    
     ~Matrix() {
-        if (data_) delete[] data_;
+        internal::deallocate(data_, source_);
     }
     
     // Copy constructor
-    Matrix(const Matrix& other) : rows_(other.rows_), cols_(other.cols_) {
-        data_ = new T[rows_ * cols_];
-        for (int i = 0; i < rows_ * cols_; i++) {
-            data_[i] = other.data_[i];
-        }
+    Matrix(const Matrix& other) : Matrix(other.rows_, other.cols_, Uninitialized) {
+        std::copy(other.data_, other.data_ + size(), data_);
+    }
+    
+    // Move constructor
+    Matrix(Matrix&& other) noexcept
+        : rows_(other.rows_), cols_(other.cols_), capacity_(other.capacity_), data_(other.data_),
+          source_(other.source_) {
+        other.rows_ = other.cols_ = other.capacity_ = 0;
+        other.data_ = nullptr;
+        other.source_ = internal::kHeapBuffer;
     }
     
-    // Assignment operator
+    // Assignment operator, reusing the buffer when it is large enough
     Matrix& operator=(const Matrix& other) {
         if (this != &other) {
-            if (data_) delete[] data_;
+            resize(other.rows_, other.cols_);
+            std::copy(other.data_, other.data_ + size(), data_);
+        }
+        return *this;
+    }
+    
+    // Move assignment
+    Matrix& operator=(Matrix&& other) noexcept {
+        if (this != &other) {
+            internal::deallocate(data_, source_);
             rows_ = other.rows_;
             cols_ = other.cols_;
-            data_ = new T[rows_ * cols_];
-            for (int i = 0; i < rows_ * cols_; i++) {
-                data_[i] = other.data_[i];
-            }
+            capacity_ = other.capacity_;
+            data_ = other.data_;
+            source_ = other.source_;
+            other.rows_ = other.cols_ = other.capacity_ = 0;
+            other.data_ = nullptr;
+            other.source_ = internal::kHeapBuffer;
         }
         return *this;
     }
     
+    // Change the dimensions. The buffer is only reallocated when it is too
+    // small or stale (see Arena), and the contents are left uninitialized.
+    void resize(int rows, int cols) {
+        if (rows * cols > capacity_ || internal::isStale(source_)) {
+            internal::deallocate(data_, source_);
+            data_ = internal::allocate<T>(rows * cols, source_);
+            capacity_ = rows * cols;
+        }
+        rows_ = rows;
+        cols_ = cols;
+    }
+    
+    void setZero() {
+        std::fill(data_, data_ + size(), T(0));
+    }
+    
     // Element access
     T& operator()(int row, int col) {
         return data_[row * cols_ + col];
@@ -66,16 +381,15 @@ public:
     // Accessor methods for dimensions
     int rows() const { return rows_; }
     int cols() const { return cols_; }
+    int size() const { return rows_ * cols_; }
     
-    // Matrix transpose
-    Matrix transpose() const {
-        Matrix result(cols_, rows_);
-        for (int i = 0; i < rows_; i++) {
-            for (int j = 0; j < cols_; j++) {
-                result(j, i) = (*this)(i, j);
-            }
-        }
-        return result;
+    // Row-major storage
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    
+    // Lazy transpose; see the Transpose products below
+    Transpose<T> transpose() const {
+        return Transpose<T>(*this);
     }
     
     // Matrix multiplication
@@ -85,7 +399,7 @@ public:
             return Matrix(0, 0);
         }
         
-        Matrix result(rows_, other.cols_);
+        Matrix result(rows_, other.cols_, Uninitialized);
         for (int i = 0; i < rows_; i++) {
             for (int j = 0; j < other.cols_; j++) {
                 T sum = T(0);
@@ -98,29 +412,22 @@ public:
         return result;
     }
     
-    // QR decomposition for solving least squares
-    class HouseholderQR {
+    // Gaussian elimination with partial pivoting for square systems
+    class PartialPivLU {
     public:
-        HouseholderQR(const Matrix& matrix) : m_(matrix) {
-            // Simplified QR implementation
-        }
+        PartialPivLU(const Matrix& matrix) : m_(matrix) {}
         
         Vector<T> solve(const Vector<T>& b) const {
-            // For polynomial fitting, use normal equations (A^T * A) * x = A^T * b
-            Matrix ATA = m_.transpose() * m_;
-            Vector<T> ATb = m_.transpose() * b;
-            
-            // Solve using Gaussian elimination
-            int n = ATA.cols();
+            int n = m_.cols();
             Vector<T> x(n);
             
-            // Create augmented matrix [ATA | ATb]
+            // Create augmented matrix [A | b]
             Matrix<T> aug(n, n + 1);
             for (int i = 0; i < n; i++) {
                 for (int j = 0; j < n; j++) {
-                    aug(i, j) = ATA(i, j);
+                    aug(i, j) = m_(i, j);
                 }
-                aug(i, n) = ATb(i);
+                aug(i, n) = b(i);
             }
             
             // Gaussian elimination with partial pivoting
@@ -168,58 +475,329 @@ public:
         Matrix m_;
     };
     
-    HouseholderQR householderQr() const {
+    PartialPivLU partialPivLu() const {
+        return PartialPivLU(*this);
+    }
+    
+    // Householder QR decomposition for solving least squares.
+    // The factorization is computed once in the constructor and stored
+    // compactly: R in the upper triangle, the essential part of each
+    // Householder vector below the diagonal and the scalars in tau_.
+    // solve() only applies Q^T and back-substitutes, so it can be called
+    // for any number of right-hand sides without refactoring.
+    class HouseholderQR {
+    public:
+        HouseholderQR() {}
+        
+        // Preallocate storage for rows x cols problems, so later compute()
+        // and solve() calls of at most that size do not touch the heap
+        HouseholderQR(int rows, int cols)
+            : qr_(rows, cols, Uninitialized), tau_(cols, Uninitialized),
+              w_(cols, Uninitialized), w_block_(cols, Uninitialized),
+              y_(rows, Uninitialized) {}
+        
+        HouseholderQR(const Matrix& matrix) {
+            compute(matrix);
+        }
+        
+        HouseholderQR(Matrix&& matrix) {
+            compute(std::move(matrix));
+        }
+        
+        HouseholderQR& compute(const Matrix& matrix) {
+            qr_ = matrix;
+            factorize();
+            return *this;
+        }
+        
+        // Factorize in the caller's buffer without copying it
+        HouseholderQR& compute(Matrix&& matrix) {
+            qr_ = std::move(matrix);
+            factorize();
+            return *this;
+        }
+        
+        Vector<T> solve(const Vector<T>& b) const {
+            Vector<T> x;
+            solve(b, x);
+            return x;
+        }
+        
+        void solve(const Vector<T>& b, Vector<T>& x) const {
+            int m = qr_.rows();
+            int n = qr_.cols();
+            int k_end = std::min(m, n);
+            x.resize(n);
+            x.setZero();
+            if (b.size() != m) return;
+            
+            // y = Q^T * b, one reflector at a time
+            Vector<T>& y = y_;
+            y = b;
+            for (int k = 0; k < k_end; k++) {
+                applyReflector(k, y);
+            }
+            
+            // Back substitution with R. Negligible pivots mean the data
+            // cannot determine that coefficient (e.g. fewer distinct x
+            // values than terms), so it is left at zero.
+            T threshold = pivotThreshold();
+            for (int i = k_end - 1; i >= 0; i--) {
+                if (std::abs(qr_(i, i)) <= threshold) continue;
+                T sum = y(i);
+                for (int j = i + 1; j < n; j++) {
+                    sum -= qr_(i, j) * x(j);
+                }
+                x(i) = sum / qr_(i, i);
+            }
+        }
+        
+        // Diagonal of the hat matrix H = Q1 * Q1^T, i.e. the leverage h_i of
+        // each row, from the columns of the thin Q in O(m * n^2). Given the
+        // residuals r of a fit, r_i / (1 - h_i) is the residual row i would
+        // have if it were left out of the fit, so the leave-one-out error
+        // (PRESS) needs no refitting.
+        void hatDiagonal(Vector<T>& h) const {
+            int m = qr_.rows();
+            int k_end = std::min(m, qr_.cols());
+            h.resize(m);
+            h.setZero();
+            
+            // Q e_j = H_0 * ... * H_j * e_j, as reflectors past j leave e_j alone
+            Vector<T>& q = y_;
+            q.resize(m);
+            for (int j = 0; j < k_end; j++) {
+                q.setZero();
+                q(j) = T(1);
+                for (int k = j; k >= 0; k--) {
+                    applyReflector(k, q);
+                }
+                for (int i = 0; i < m; i++) {
+                    h(i) += q(i) * q(i);
+                }
+            }
+        }
+        
+        // Packed factor: R on and above the diagonal, Householder vectors below
+        const Matrix& matrixQR() const { return qr_; }
+        const Vector<T>& householderCoeffs() const { return tau_; }
+        
+    private:
+        void factorize() {
+            int m = qr_.rows();
+            int n = qr_.cols();
+            int k_end = std::min(m, n);
+            tau_.resize(n);
+            w_.resize(n);
+            w_block_.resize(n);
+            Vector<T>& w = w_;
+            Vector<T>& w_block = w_block_;
+            
+            for (int k = 0; k < k_end; k++) {
+                // Scaled norm of the column below the diagonal
+                T scale = T(0);
+                for (int i = k; i < m; i++) {
+                    scale = std::max(scale, std::abs(qr_(i, k)));
+                }
+                if (scale == T(0)) {
+                    tau_(k) = T(0);
+                    continue;
+                }
+                T sum_sq = T(0);
+                for (int i0 = k; i0 < m; i0 += kSumBlock) {
+                    int i1 = std::min(m, i0 + kSumBlock);
+                    T block = T(0);
+                    for (int i = i0; i < i1; i++) {
+                        T v = qr_(i, k) / scale;
+                        block += v * v;
+                    }
+                    sum_sq += block;
+                }
+                T alpha = qr_(k, k);
+                T norm = scale * std::sqrt(sum_sq);
+                T beta = alpha >= T(0) ? -norm : norm;
+                
+                // v = [1, x(k+1:m) / (alpha - beta)], tau = (beta - alpha) / beta
+                T inv = T(1) / (alpha - beta);
+                for (int i = k + 1; i < m; i++) {
+                    qr_(i, k) *= inv;
+                }
+                T tau = (beta - alpha) / beta;
+                tau_(k) = tau;
+                qr_(k, k) = beta;
+                
+                // Apply H = I - tau * v * v^T to the trailing columns.
+                // Rows are contiguous, so accumulate w = v^T * A row by row.
+                // Partial sums per block of rows keep the float rounding
+                // error from growing with the number of points.
+                for (int j = k + 1; j < n; j++) {
+                    w(j) = qr_(k, j);
+                }
+                for (int i0 = k + 1; i0 < m; i0 += kSumBlock) {
+                    int i1 = std::min(m, i0 + kSumBlock);
+                    for (int j = k + 1; j < n; j++) {
+                        w_block(j) = T(0);
+                    }
+                    for (int i = i0; i < i1; i++) {
+                        T vi = qr_(i, k);
+                        const T* row = &qr_(i, 0);
+                        for (int j = k + 1; j < n; j++) {
+                            w_block(j) += vi * row[j];
+                        }
+                    }
+                    for (int j = k + 1; j < n; j++) {
+                        w(j) += w_block(j);
+                    }
+                }
+                for (int j = k + 1; j < n; j++) {
+                    w(j) *= tau;
+                    qr_(k, j) -= w(j);
+                }
+                for (int i = k + 1; i < m; i++) {
+                    T vi = qr_(i, k);
+                    T* row = &qr_(i, 0);
+                    for (int j = k + 1; j < n; j++) {
+                        row[j] -= vi * w(j);
+                    }
+                }
+            }
+        }
+        
+        // v <- H_k * v with H_k = I - tau_k * u_k * u_k^T (H_k is symmetric,
+        // so this applies both Q and Q^T one reflector at a time)
+        void applyReflector(int k, Vector<T>& v) const {
+            int m = qr_.rows();
+            T tau = tau_(k);
+            if (tau == T(0)) return;
+            
+            T dot = v(k);
+            for (int i0 = k + 1; i0 < m; i0 += kSumBlock) {
+                int i1 = std::min(m, i0 + kSumBlock);
+                T block = T(0);
+                for (int i = i0; i < i1; i++) {
+                    block += qr_(i, k) * v(i);
+                }
+                dot += block;
+            }
+            dot *= tau;
+            
+            v(k) -= dot;
+            for (int i = k + 1; i < m; i++) {
+                v(i) -= dot * qr_(i, k);
+            }
+        }
+        
+        T pivotThreshold() const {
+            int k_end = std::min(qr_.rows(), qr_.cols());
+            T max_diag = T(0);
+            for (int i = 0; i < k_end; i++) {
+                max_diag = std::max(max_diag, std::abs(qr_(i, i)));
+            }
+            return max_diag * std::numeric_limits<T>::epsilon() * k_end;
+        }
+        
+        static const int kSumBlock = 128;
+        
+        Matrix qr_;
+        Vector<T> tau_;
+        
+        // Workspaces kept between calls to avoid reallocating
+        Vector<T> w_;
+        Vector<T> w_block_;
+        mutable Vector<T> y_;
+    };
+    
+    HouseholderQR householderQr() const & {
         return HouseholderQR(*this);
     }
     
+    // Factorize a temporary in place, e.g. std::move(A).householderQr()
+    HouseholderQR householderQr() && {
+        return HouseholderQR(std::move(*this));
+    }
+    
 private:
     int rows_;
     int cols_;
+    int capacity_;
     T* data_;
+    internal::BufferSource source_;
     
     // Allow Vector class and friend functions to access private members
-    template<typename U> friend class Vector;
+    template<typename U, int S> friend class Vector;
     template<typename U> friend Vector<U> operator*(const Matrix<U>&, const Vector<U>&);
 };
 
 // Simplified vector class (1D matrix)
 template<typename T>
-class Vector {
+class Vector<T, Dynamic> {
 public:
-    Vector() : size_(0), data_(nullptr) {}
+    Vector() : size_(0), capacity_(0), data_(nullptr), source_(internal::kHeapBuffer) {}
     
-    Vector(int size) : size_(size) {
-        data_ = new T[size];
-        for (int i = 0; i < size; i++) {
-            data_[i] = T(0);
-        }
+    Vector(int size) : Vector(size, Uninitialized) {
+        std::fill(data_, data_ + size_, T(0));
     }
     
+    Vector(int size, UninitializedTag)
+        : size_(size), capacity_(size), data_(internal::allocate<T>(size, source_)) {}
+    
     ~Vector() {
-        if (data_) delete[] data_;
+        internal::deallocate(data_, source_);
     }
     
     // Copy constructor
-    Vector(const Vector& other) : size_(other.size_) {
-        data_ = new T[size_];
-        for (int i = 0; i < size_; i++) {
-            data_[i] = other.data_[i];
-        }
+    Vector(const Vector& other) : Vector(other.size_, Uninitialized) {
+        std::copy(other.data_, other.data_ + size_, data_);
+    }
+    
+    // Move constructor
+    Vector(Vector&& other) noexcept
+        : size_(other.size_), capacity_(other.capacity_), data_(other.data_),
+          source_(other.source_) {
+        other.size_ = other.capacity_ = 0;
+        other.data_ = nullptr;
+        other.source_ = internal::kHeapBuffer;
     }
     
-    // Assignment operator
+    // Assignment operator, reusing the buffer when it is large enough
     Vector& operator=(const Vector& other) {
         if (this != &other) {
-            if (data_) delete[] data_;
+            resize(other.size_);
+            std::copy(other.data_, other.data_ + size_, data_);
+        }
+        return *this;
+    }
+    
+    // Move assignment
+    Vector& operator=(Vector&& other) noexcept {
+        if (this != &other) {
+            internal::deallocate(data_, source_);
             size_ = other.size_;
-            data_ = new T[size_];
-            for (int i = 0; i < size_; i++) {
-                data_[i] = other.data_[i];
-            }
+            capacity_ = other.capacity_;
+            data_ = other.data_;
+            source_ = other.source_;
+            other.size_ = other.capacity_ = 0;
+            other.data_ = nullptr;
+            other.source_ = internal::kHeapBuffer;
         }
         return *this;
     }
     
+    // Change the size. The buffer is only reallocated when it is too small
+    // or stale (see Arena), and the contents are left uninitialized.
+    void resize(int size) {
+        if (size > capacity_ || internal::isStale(source_)) {
+            internal::deallocate(data_, source_);
+            data_ = internal::allocate<T>(size, source_);
+            capacity_ = size;
+        }
+        size_ = size;
+    }
+    
+    void setZero() {
+        std::fill(data_, data_ + size_, T(0));
+    }
+    
     // Element access
     T& operator()(int index) {
         return data_[index];
@@ -232,24 +810,267 @@ public:
     // Get vector size
     int size() const { return size_; }
     
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    
     // Vector as a matrix
-    operator Matrix<T>() const {
-        Matrix<T> result(size_, 1);
-        for (int i = 0; i < size_; i++) {
-            result(i, 0) = data_[i];
-        }
+    operator Matrix<T>() const & {
+        Matrix<T> result(size_, 1, Uninitialized);
+        std::copy(data_, data_ + size_, result.data_);
+        return result;
+    }
+    
+    // A temporary vector hands its buffer over as a column matrix
+    operator Matrix<T>() && {
+        Matrix<T> result;
+        result.rows_ = size_;
+        result.cols_ = 1;
+        result.capacity_ = capacity_;
+        result.data_ = data_;
+        result.source_ = source_;
+        size_ = capacity_ = 0;
+        data_ = nullptr;
+        source_ = internal::kHeapBuffer;
         return result;
     }
     
 private:
     int size_;
+    int capacity_;
     T* data_;
+    internal::BufferSource source_;
     
     // Allow Matrix class and friend functions to access private members
-    template<typename U> friend class Matrix;
+    template<typename U, int R, int C> friend class Matrix;
     template<typename U> friend Vector<U> operator*(const Matrix<U>&, const Vector<U>&);
 };
 
+// Transposed view of a matrix. Nothing is copied: products with it read the
+// original row-major storage directly, so A.transpose() * A streams over
+// the rows of A once instead of building the transpose first.
+template<typename T>
+class Transpose {
+public:
+    explicit Transpose(const Matrix<T>& matrix) : m_(matrix) {}
+    
+    int rows() const { return m_.cols(); }
+    int cols() const { return m_.rows(); }
+    
+    const T& operator()(int row, int col) const {
+        return m_(col, row);
+    }
+    
+    const Matrix<T>& nestedExpression() const { return m_; }
+    
+    // Materialize the transpose
+    Matrix<T> eval() const {
+        Matrix<T> result(rows(), cols(), Uninitialized);
+        for (int i = 0; i < m_.rows(); i++) {
+            for (int j = 0; j < m_.cols(); j++) {
+                result(j, i) = m_(i, j);
+            }
+        }
+        return result;
+    }
+    
+    operator Matrix<T>() const {
+        return eval();
+    }
+    
+private:
+    const Matrix<T>& m_;
+};
+
+namespace internal {
+
+// Rows per partial sum of the normal equations kernel. As in the QR, the
+// blocks keep the float rounding error from growing with the row count.
+const int kRankUpdateBlock = 128;
+
+// acc[j] += c0 * a0[j] + ... + c3 * a3[j] for as many leading j < count as
+// whole SIMD vectors cover, returning how many were done. The scalar loop
+// of the caller finishes the rest; types and targets without vectors do
+// none here.
+template<typename T>
+int rankUpdateLanes(T, T, T, T, const T*, const T*, const T*, const T*, T*, int) {
+    return 0;
+}
+
+#if defined(EIGEN_VECTORIZE_AVX)
+inline int rankUpdateLanes(float c0, float c1, float c2, float c3,
+                           const float* a0, const float* a1, const float* a2,
+                           const float* a3, float* acc, int count) {
+    __m256 v0 = _mm256_set1_ps(c0), v1 = _mm256_set1_ps(c1);
+    __m256 v2 = _mm256_set1_ps(c2), v3 = _mm256_set1_ps(c3);
+    int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 s01 = _mm256_add_ps(_mm256_mul_ps(v0, _mm256_loadu_ps(a0 + j)),
+                                   _mm256_mul_ps(v1, _mm256_loadu_ps(a1 + j)));
+        __m256 s23 = _mm256_add_ps(_mm256_mul_ps(v2, _mm256_loadu_ps(a2 + j)),
+                                   _mm256_mul_ps(v3, _mm256_loadu_ps(a3 + j)));
+        _mm256_storeu_ps(acc + j, _mm256_add_ps(_mm256_loadu_ps(acc + j),
+                                                _mm256_add_ps(s01, s23)));
+    }
+    return j;
+}
+#elif defined(EIGEN_VECTORIZE_SSE)
+inline int rankUpdateLanes(float c0, float c1, float c2, float c3,
+                           const float* a0, const float* a1, const float* a2,
+                           const float* a3, float* acc, int count) {
+    __m128 v0 = _mm_set1_ps(c0), v1 = _mm_set1_ps(c1);
+    __m128 v2 = _mm_set1_ps(c2), v3 = _mm_set1_ps(c3);
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m128 s01 = _mm_add_ps(_mm_mul_ps(v0, _mm_loadu_ps(a0 + j)),
+                                _mm_mul_ps(v1, _mm_loadu_ps(a1 + j)));
+        __m128 s23 = _mm_add_ps(_mm_mul_ps(v2, _mm_loadu_ps(a2 + j)),
+                                _mm_mul_ps(v3, _mm_loadu_ps(a3 + j)));
+        _mm_storeu_ps(acc + j, _mm_add_ps(_mm_loadu_ps(acc + j), _mm_add_ps(s01, s23)));
+    }
+    return j;
+}
+#endif
+
+// Symmetric rank-k update acc += [A b]^T A over rows of row-major A, upper
+// triangle only: acc is cols x (cols + 1) row-major, with A^T b (when b is
+// given) in its last column. Four rows go through together, so every
+// accumulator is loaded and stored once per four rows and the four
+// products are independent. The j loops are contiguous in both A and acc.
+template<typename T>
+void rankUpdateUpper(const T* a, const T* b, int rows, int cols, T* acc) {
+    const int stride = cols + 1;
+    int r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const T* a0 = a + r * cols;
+        const T* a1 = a0 + cols;
+        const T* a2 = a1 + cols;
+        const T* a3 = a2 + cols;
+        for (int i = 0; i < cols; i++) {
+            T c0 = a0[i], c1 = a1[i], c2 = a2[i], c3 = a3[i];
+            T* acc_row = acc + i * stride;
+            int j = i + rankUpdateLanes(c0, c1, c2, c3, a0 + i, a1 + i, a2 + i, a3 + i,
+                                        acc_row + i, cols - i);
+            for (; j < cols; j++) {
+                acc_row[j] += (c0 * a0[j] + c1 * a1[j]) + (c2 * a2[j] + c3 * a3[j]);
+            }
+            if (b) {
+                acc_row[cols] += (c0 * b[r] + c1 * b[r + 1]) + (c2 * b[r + 2] + c3 * b[r + 3]);
+            }
+        }
+    }
+    for (; r < rows; r++) {
+        const T* a0 = a + r * cols;
+        for (int i = 0; i < cols; i++) {
+            T c0 = a0[i];
+            T* acc_row = acc + i * stride;
+            for (int j = i; j < cols; j++) {
+                acc_row[j] += c0 * a0[j];
+            }
+            if (b) acc_row[cols] += c0 * b[r];
+        }
+    }
+}
+
+} // namespace internal
+
+// Normal equations A^T A and A^T b of a least-squares problem in one
+// streaming pass over the rows of A, without forming the transpose (a
+// BLAS SYRK plus GEMV). Only the upper triangle is accumulated and then
+// mirrored. b may be null to compute A^T A alone. The workspace is kept
+// by the caller so repeated calls do not allocate.
+template<typename T>
+void normalEquations(const Matrix<T>& a, const T* b, Matrix<T>& ata, Vector<T>& atb,
+                     Vector<T>& workspace) {
+    const int rows = a.rows();
+    const int cols = a.cols();
+    const int stride = cols + 1;
+    ata.resize(cols, cols);
+    ata.setZero();
+    atb.resize(b ? cols : 0);
+    atb.setZero();
+    workspace.resize(cols * stride);
+    T* block = workspace.data();
+    
+    for (int r0 = 0; r0 < rows; r0 += internal::kRankUpdateBlock) {
+        int count = std::min(rows - r0, internal::kRankUpdateBlock);
+        std::fill(block, block + cols * stride, T(0));
+        internal::rankUpdateUpper(a.data() + r0 * cols, b ? b + r0 : nullptr,
+                                  count, cols, block);
+        for (int i = 0; i < cols; i++) {
+            const T* block_row = block + i * stride;
+            T* ata_row = &ata(i, 0);
+            for (int j = i; j < cols; j++) {
+                ata_row[j] += block_row[j];
+            }
+            if (b) atb(i) += block_row[cols];
+        }
+    }
+    for (int i = 0; i < cols; i++) {
+        for (int j = 0; j < i; j++) {
+            ata(i, j) = ata(j, i);
+        }
+    }
+}
+
+template<typename T>
+void normalEquations(const Matrix<T>& a, const Vector<T>& b, Matrix<T>& ata, Vector<T>& atb) {
+    Vector<T> workspace;
+    normalEquations(a, b.size() == a.rows() ? b.data() : nullptr, ata, atb, workspace);
+}
+
+// A^T * B, accumulated as a sum of outer products of the rows of A and B.
+// A^T * A goes through the symmetric kernel above.
+template<typename T>
+Matrix<T> operator*(const Transpose<T>& lhs, const Matrix<T>& rhs) {
+    const Matrix<T>& a = lhs.nestedExpression();
+    if (a.rows() != rhs.rows()) {
+        // Error - incompatible matrices
+        return Matrix<T>(0, 0);
+    }
+    
+    if (&a == &rhs) {
+        Matrix<T> result;
+        Vector<T> unused;
+        Vector<T> workspace;
+        normalEquations(a, (const T*)nullptr, result, unused, workspace);
+        return result;
+    }
+    
+    Matrix<T> result(a.cols(), rhs.cols());
+    for (int k = 0; k < a.rows(); k++) {
+        const T* a_row = &a(k, 0);
+        const T* b_row = &rhs(k, 0);
+        for (int i = 0; i < a.cols(); i++) {
+            T a_ki = a_row[i];
+            T* r_row = &result(i, 0);
+            for (int j = 0; j < rhs.cols(); j++) {
+                r_row[j] += a_ki * b_row[j];
+            }
+        }
+    }
+    return result;
+}
+
+// A^T * b
+template<typename T>
+Vector<T> operator*(const Transpose<T>& lhs, const Vector<T>& rhs) {
+    const Matrix<T>& a = lhs.nestedExpression();
+    if (a.rows() != rhs.size()) {
+        // Error - incompatible dimensions
+        return Vector<T>(0);
+    }
+    
+    Vector<T> result(a.cols());
+    for (int k = 0; k < a.rows(); k++) {
+        const T* a_row = &a(k, 0);
+        T b_k = rhs(k);
+        for (int i = 0; i < a.cols(); i++) {
+            result(i) += a_row[i] * b_k;
+        }
+    }
+    return result;
+}
+
 // Matrix * Vector multiplication
 template<typename T>
 Vector<T> operator*(const Matrix<T>& matrix, const Vector<T>& vector) {
@@ -258,7 +1079,7 @@ Vector<T> operator*(const Matrix<T>& matrix, const Vector<T>& vector) {
         return Vector<T>(0);
     }
     
-    Vector<T> result(matrix.rows_);
+    Vector<T> result(matrix.rows_, Uninitialized);
     for (int i = 0; i < matrix.rows_; i++) {
         T sum = T(0);
         for (int j = 0; j < matrix.cols_; j++) {
@@ -269,4 +1090,178 @@ Vector<T> operator*(const Matrix<T>& matrix, const Vector<T>& vector) {
     return result;
 }
 
+// Fixed-size matrix stored inline, for small systems such as the normal
+// equations of a low-degree fit. Nothing is heap-allocated and all loops
+// have compile-time bounds, so the kernels below unroll completely.
+template<typename T, int Rows, int Cols>
+class Matrix {
+public:
+    // Uninitialized, like a plain array
+    Matrix() {}
+    
+    // Element access
+    T& operator()(int row, int col) {
+        return data_[row][col];
+    }
+    
+    const T& operator()(int row, int col) const {
+        return data_[row][col];
+    }
+    
+    static constexpr int rows() { return Rows; }
+    static constexpr int cols() { return Cols; }
+    static constexpr int size() { return Rows * Cols; }
+    
+    // Row-major storage
+    T* data() { return &data_[0][0]; }
+    const T* data() const { return &data_[0][0]; }
+    
+    void setZero() {
+        EIGEN_UNROLL
+        for (int i = 0; i < Rows; i++) {
+            EIGEN_UNROLL
+            for (int j = 0; j < Cols; j++) {
+                data_[i][j] = T(0);
+            }
+        }
+    }
+    
+    // LU factorization with partial pivoting for square systems. The row
+    // permutation is kept as an index array so solve() can be called for
+    // several right-hand sides.
+    class PartialPivLU {
+    public:
+        static_assert(Rows == Cols, "PartialPivLU needs a square matrix");
+        
+        // Empty factorization, to be assigned one later
+        PartialPivLU() : threshold_(T(0)) {
+            EIGEN_UNROLL
+            for (int i = 0; i < Rows; i++) {
+                perm_[i] = i;
+            }
+        }
+        
+        PartialPivLU(const Matrix& matrix) : lu_(matrix) {
+            T max_entry = T(0);
+            EIGEN_UNROLL
+            for (int i = 0; i < Rows; i++) {
+                perm_[i] = i;
+                EIGEN_UNROLL
+                for (int j = 0; j < Cols; j++) {
+                    max_entry = std::max(max_entry, std::abs(matrix(i, j)));
+                }
+            }
+            threshold_ = max_entry * std::numeric_limits<T>::epsilon() * Rows;
+            
+            EIGEN_UNROLL
+            for (int k = 0; k < Rows; k++) {
+                // Find pivot
+                int pivot = k;
+                EIGEN_UNROLL
+                for (int i = k + 1; i < Rows; i++) {
+                    if (std::abs(lu_(i, k)) > std::abs(lu_(pivot, k))) {
+                        pivot = i;
+                    }
+                }
+                
+                // Swap rows
+                if (pivot != k) {
+                    EIGEN_UNROLL
+                    for (int j = 0; j < Cols; j++) {
+                        std::swap(lu_(k, j), lu_(pivot, j));
+                    }
+                    std::swap(perm_[k], perm_[pivot]);
+                }
+                
+                // Eliminate below, keeping the multipliers in place of L
+                T diag = lu_(k, k);
+                T inv = std::abs(diag) > threshold_ ? T(1) / diag : T(0);
+                EIGEN_UNROLL
+                for (int i = k + 1; i < Rows; i++) {
+                    T factor = lu_(i, k) * inv;
+                    lu_(i, k) = factor;
+                    EIGEN_UNROLL
+                    for (int j = k + 1; j < Cols; j++) {
+                        lu_(i, j) -= factor * lu_(k, j);
+                    }
+                }
+            }
+        }
+        
+        Vector<T, Rows> solve(const Vector<T, Rows>& b) const {
+            Vector<T, Rows> x;
+            
+            // Forward substitution with the unit lower triangle
+            EIGEN_UNROLL
+            for (int i = 0; i < Rows; i++) {
+                T sum = b(perm_[i]);
+                EIGEN_UNROLL
+                for (int j = 0; j < i; j++) {
+                    sum -= lu_(i, j) * x(j);
+                }
+                x(i) = sum;
+            }
+            
+            // Back substitution. A pivot that is rounding error next to
+            // the largest entry of the matrix means the system does not
+            // determine that unknown, so it is left at zero, as in the QR.
+            EIGEN_UNROLL
+            for (int i = Rows - 1; i >= 0; i--) {
+                T sum = x(i);
+                EIGEN_UNROLL
+                for (int j = i + 1; j < Cols; j++) {
+                    sum -= lu_(i, j) * x(j);
+                }
+                x(i) = std::abs(lu_(i, i)) > threshold_ ? sum / lu_(i, i) : T(0);
+            }
+            
+            return x;
+        }
+        
+    private:
+        Matrix lu_;
+        int perm_[Rows];
+        T threshold_;    // Pivots at or below it count as zero
+    };
+    
+    PartialPivLU partialPivLu() const {
+        return PartialPivLU(*this);
+    }
+    
+private:
+    T data_[Rows][Cols];
+};
+
+// Fixed-size vector stored inline
+template<typename T, int Size>
+class Vector {
+public:
+    // Uninitialized, like a plain array
+    Vector() {}
+    
+    // Element access
+    T& operator()(int index) {
+        return data_[index];
+    }
+    
+    const T& operator()(int index) const {
+        return data_[index];
+    }
+    
+    static constexpr int size() { return Size; }
+    
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    
+    void setZero() {
+        EIGEN_UNROLL
+        for (int i = 0; i < Size; i++) {
+            data_[i] = T(0);
+        }
+    }
+    
+private:
+    T data_[Size];
+};
+
 } // namespace Eigen
\ No newline at end of file
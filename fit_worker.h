@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <type_traits>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// Background task for work the UI must not wait on, such as fits.
+//
+// Jobs go through a queue one deep: a job submitted while another is
+// still waiting replaces it, so the worker always picks up the latest.
+// A job can also cancel the one in flight. The running job polls
+// cancelled() and stops early, and a cancelled job's result is never
+// posted.
+//
+// Results come back through a triple buffer. The worker fills a slot of
+// its own and posts it with one atomic exchange. The reader takes the
+// newest posted slot with another exchange and keeps it until its next
+// take. Neither side ever waits for the other, and a result not taken yet
+// is simply replaced by a newer one. Progress is one more atomic.
+//
+// On the ESP32 the worker is a FreeRTOS task pinned to a core, on the
+// host a std::thread. If the task cannot be created, jobs run inline in
+// submit(). Job is copied into the queue, so keep it small and plain.
+template<typename Job, typename Result>
+class FitWorker {
+public:
+    static_assert(std::is_trivially_copyable<Job>::value, "Jobs are copied as bytes");
+    
+    // Compute job into result, on the worker. id is the job's, as returned
+    // by submit().
+    typedef void (*Run)(void* context, const Job& job, uint32_t id, Result& result);
+    
+    FitWorker()
+        : run_(nullptr), context_(nullptr), next_id_(1), cancel_before_(0), running_(0),
+          progress_(0.0f), back_(0), middle_(1), front_(2) {
+        ids_[0] = ids_[1] = ids_[2] = 0;
+#if defined(ESP_PLATFORM)
+        task_ = nullptr;
+        queue_ = nullptr;
+#else
+        pending_ = false;
+        stopping_ = false;
+#endif
+    }
+    
+    ~FitWorker() {
+#if defined(ESP_PLATFORM)
+        if (task_) vTaskDelete(task_);
+        if (queue_) vQueueDelete(queue_);
+#else
+        if (thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wake_.notify_one();
+            thread_.join();
+        }
+#endif
+    }
+    
+    // Start the worker on the given core (ignored on the host). Returns
+    // false if it runs jobs inline instead.
+    bool start(Run run, void* context, int core, uint32_t stack_size, int priority) {
+        run_ = run;
+        context_ = context;
+#if defined(ESP_PLATFORM)
+        queue_ = xQueueCreate(1, sizeof(Item));
+        if (!queue_ ||
+            xTaskCreatePinnedToCore(workerTask, "fit", stack_size, this, priority, &task_,
+                                    core) != pdPASS) {
+            task_ = nullptr;
+        }
+        return task_ != nullptr;
+#else
+        (void)core;
+        (void)stack_size;
+        (void)priority;
+        thread_ = std::thread(&FitWorker::workerLoop, this);
+        return true;
+#endif
+    }
+    
+    // Queue a job, replacing any still waiting. With cancel_running, the
+    // job in flight is cancelled as well. Returns the job's id; ids start
+    // at 1 and increase.
+    uint32_t submit(const Job& job, bool cancel_running) {
+        Item item;
+        item.id = next_id_.fetch_add(1);
+        item.job = job;
+        if (cancel_running) cancel_before_.store(item.id);
+#if defined(ESP_PLATFORM)
+        if (task_) {
+            xQueueOverwrite(queue_, &item);
+        } else {
+            execute(item);
+        }
+#else
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            item_ = item;
+            pending_ = true;
+        }
+        wake_.notify_one();
+#endif
+        return item.id;
+    }
+    
+    // Cancel the job in flight and any waiting. Returns the id the next
+    // job will get; no earlier job posts a result after this returns,
+    // except one posted already and not taken yet.
+    uint32_t cancel() {
+        uint32_t id = next_id_.load();
+        cancel_before_.store(id);
+        return id;
+    }
+    
+    // As cancel(), and wait for the worker to let go of the job in flight,
+    // so that what the job reads can be changed. A cancelled job stops at
+    // its next poll of cancelled().
+    uint32_t cancelAndWait() {
+        uint32_t id = cancel();
+        while (running_.load() != 0) {
+#if defined(ESP_PLATFORM)
+            vTaskDelay(1);
+#else
+            std::this_thread::yield();
+#endif
+        }
+        return id;
+    }
+    
+    // The newest posted result not taken yet, and its job's id, or
+    // nullptr. It stays valid until the next take().
+    Result* take(uint32_t& id) {
+        if (!(middle_.load() & kFresh)) return nullptr;
+        front_ = middle_.exchange(front_) & kIndexMask;
+        id = ids_[front_];
+        return &slots_[front_];
+    }
+    
+    // Id of the job in flight, 0 when idle, and how far it has come (0..1)
+    uint32_t runningJob() const { return running_.load(); }
+    float progress() const { return progress_.load(); }
+    
+    // For the running job: whether a later job cancelled it, and a report
+    // of how far it has come
+    bool cancelled() const { return running_.load() < cancel_before_.load(); }
+    void setProgress(float fraction) { progress_.store(fraction); }
+
+private:
+    struct Item {
+        uint32_t id;
+        Job job;
+    };
+    
+    // Slot index in the low bits of middle_, and whether it holds a result
+    // the reader has not taken
+    static const uint8_t kIndexMask = 3;
+    static const uint8_t kFresh = 4;
+    
+    // The job is marked running before its cancel check, so that
+    // cancelAndWait() either sees it running or it sees the cancel
+    void execute(const Item& item) {
+        progress_.store(0.0f);
+        running_.store(item.id);
+        if (item.id < cancel_before_.load()) {
+            running_.store(0);
+            return;
+        }
+        run_(context_, item.job, item.id, slots_[back_]);
+        bool cancelled = item.id < cancel_before_.load();
+        running_.store(0);
+        if (cancelled) return;
+        ids_[back_] = item.id;
+        back_ = middle_.exchange(back_ | kFresh) & kIndexMask;
+    }
+
+#if defined(ESP_PLATFORM)
+    static void workerTask(void* arg) {
+        FitWorker* self = (FitWorker*)arg;
+        Item item;
+        for (;;) {
+            if (xQueueReceive(self->queue_, &item, portMAX_DELAY) == pdTRUE) {
+                self->execute(item);
+            }
+        }
+    }
+#else
+    void workerLoop() {
+        for (;;) {
+            Item item;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return pending_ || stopping_; });
+                if (stopping_) return;
+                item = item_;
+                pending_ = false;
+            }
+            execute(item);
+        }
+    }
+#endif
+
+    Run run_;
+    void* context_;
+    
+    // Next job id, jobs below cancel_before_ are cancelled, and the job
+    // running with its progress
+    std::atomic<uint32_t> next_id_;
+    std::atomic<uint32_t> cancel_before_;
+    std::atomic<uint32_t> running_;
+    std::atomic<float> progress_;
+    
+    // Result slots: the worker's back slot, the middle one passed between
+    // the two sides, and the reader's front slot, with the job id of each
+    Result slots_[3];
+    uint32_t ids_[3];
+    uint8_t back_;
+    std::atomic<uint8_t> middle_;
+    uint8_t front_;
+
+#if defined(ESP_PLATFORM)
+    TaskHandle_t task_;
+    QueueHandle_t queue_;
+#else
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    Item item_;
+    bool pending_;
+    bool stopping_;
+#endif
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "canvas_raster.h"
+
+// Short labels, such as axis ticks, composed from glyphs rasterized once
+// instead of by the font engine for every label.
+//
+// The atlas holds the glyphs of kCharset as A8 coverage on the blend
+// scale of CanvasRaster (0..32). Each glyph is a cell one line of text
+// tall and kMargin pixels wider than its advance on either side, for the
+// parts that overhang the pen. The owner renders each glyph once with the
+// real font, white on black, and passes the rendering to add(). Drawing a
+// label is then one blended copy of a cell per character, straight into
+// an RGB565 buffer, with no font lookup.
+//
+// Glyphs are placed by their advance alone, without kerning. The cells
+// share one buffer, allocated by reset().
+class GlyphAtlas {
+public:
+    // Characters a label can be made of
+    static constexpr char kCharset[] = "0123456789-.XY";
+    
+    // Pixels left and right of a glyph's advance kept in its cell
+    static const int kMargin = 2;
+    
+    GlyphAtlas() : line_height_(0), cell_width_(0) {
+        std::fill(advances_, advances_ + kGlyphs, 0);
+    }
+    
+    // Empty the atlas and size its cells for glyphs line_height tall with
+    // advances up to max_advance
+    void reset(int line_height, int max_advance) {
+        line_height_ = std::max(line_height, 0);
+        cell_width_ = std::max(max_advance, 0) + 2 * kMargin;
+        coverage_.assign((size_t)kGlyphs * cell_width_ * line_height_, 0);
+        std::fill(advances_, advances_ + kGlyphs, 0);
+    }
+    
+    // Width of a cell; a glyph's pen starts kMargin pixels into it
+    int cellWidth() const { return cell_width_; }
+    int lineHeight() const { return line_height_; }
+    
+    // Take glyph c from a rendering in white on black: one cell of RGB565
+    // pixels, rows stride pixels apart. Coverage is read from the green
+    // channel, which has the most bits.
+    void add(char c, int advance, const uint16_t* pixels, int stride) {
+        int g = glyphIndex(c);
+        if (g < 0) return;
+        advances_[g] = advance;
+        uint8_t* cell = &coverage_[(size_t)g * cell_width_ * line_height_];
+        for (int row = 0; row < line_height_; row++) {
+            for (int column = 0; column < cell_width_; column++) {
+                uint32_t green = (pixels[row * stride + column] >> 5) & 0x3F;
+                cell[row * cell_width_ + column] = (uint8_t)((green * 32 + 31) / 63);
+            }
+        }
+    }
+    
+    // Whether every character of text has a glyph
+    bool covers(const char* text) const {
+        if (coverage_.empty()) return false;
+        for (const char* c = text; *c; c++) {
+            if (glyphIndex(*c) < 0) return false;
+        }
+        return true;
+    }
+    
+    // Sum of the advances of text, which must be covered
+    int textWidth(const char* text) const {
+        int width = 0;
+        for (const char* c = text; *c; c++) {
+            width += advances_[glyphIndex(*c)];
+        }
+        return width;
+    }
+    
+    // Draw text, which must be covered, in color into a width x height
+    // buffer of plain RGB565, clipped to it. The pen starts at x and the
+    // top of the line is at y.
+    void draw(uint16_t* pixels, int width, int height, int x, int y, const char* text,
+              uint16_t color) const {
+        int row0 = std::max(0, -y);
+        int row1 = std::min(line_height_, height - y);
+        for (const char* c = text; *c; c++) {
+            int g = glyphIndex(*c);
+            const uint8_t* cell = &coverage_[(size_t)g * cell_width_ * line_height_];
+            int left = x - kMargin;
+            int column0 = std::max(0, -left);
+            int column1 = std::min(cell_width_, width - left);
+            for (int row = row0; row < row1; row++) {
+                const uint8_t* alpha = cell + row * cell_width_;
+                uint16_t* line = pixels + (y + row) * width + left;
+                for (int column = column0; column < column1; column++) {
+                    if (!alpha[column]) continue;
+                    line[column] = alpha[column] >= 32
+                                       ? color
+                                       : CanvasRaster::blend(line[column], color, alpha[column]);
+                }
+            }
+            x += advances_[g];
+        }
+    }
+
+private:
+    static const int kGlyphs = sizeof(kCharset) - 1;
+    
+    static int glyphIndex(char c) {
+        const char* found = c ? strchr(kCharset, c) : nullptr;
+        return found ? (int)(found - kCharset) : -1;
+    }
+    
+    int line_height_;
+    int cell_width_;
+    int advances_[kGlyphs];
+    
+    // Cells back to back, each cell_width_ x line_height_, in kCharset
+    // order
+    std::vector<uint8_t> coverage_;
+};
@@ -511,22 +511,40 @@ static lv_disp_t *display_init(ESP_PanelLcd *lcd)
     return lv_disp_drv_register(&disp_drv);
 }
 
+static lv_point_t touch_points[LVGL_PORT_TOUCH_MAX_POINTS];
+static int touch_point_num = 0;
+
 static void touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
 {
     ESP_PanelTouch *tp = (ESP_PanelTouch *)indev_drv->user_data;
-    ESP_PanelTouchPoint point;
+    ESP_PanelTouchPoint points[LVGL_PORT_TOUCH_MAX_POINTS];
 
     /* Read data from touch controller */
-    int read_touch_result = tp->readPoints(&point, 1);
-    if (read_touch_result > 0) {
-        data->point.x = point.x;
-        data->point.y = point.y;
+    int read_touch_result = tp->readPoints(points, LVGL_PORT_TOUCH_MAX_POINTS);
+    touch_point_num = 0;
+    for (int i = 0; i < read_touch_result && i < LVGL_PORT_TOUCH_MAX_POINTS; i++) {
+        touch_points[i].x = points[i].x;
+        touch_points[i].y = points[i].y;
+        touch_point_num++;
+    }
+    if (touch_point_num > 0) {
+        data->point = touch_points[0];
         data->state = LV_INDEV_STATE_PRESSED;
     } else {
         data->state = LV_INDEV_STATE_RELEASED;
     }
 }
 
+int lvgl_port_touch_points(lv_point_t *points, int max_points)
+{
+    int num = (touch_point_num < max_points) ? touch_point_num : max_points;
+    for (int i = 0; i < num; i++) {
+        points[i] = touch_points[i];
+    }
+
+    return num;
+}
+
 static lv_indev_t *indev_init(ESP_PanelTouch *tp)
 {
     ESP_PANEL_CHECK_FALSE_RET(tp != nullptr, nullptr, "Invalid touch device");
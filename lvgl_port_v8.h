@@ -17,6 +17,8 @@
 #define LVGL_PORT_DISP_WIDTH                    (ESP_PANEL_LCD_WIDTH)   // The width of the display
 #define LVGL_PORT_DISP_HEIGHT                   (ESP_PANEL_LCD_HEIGHT)  // The height of the display
 #define LVGL_PORT_TICK_PERIOD_MS                (2) // The period of the LVGL tick task, in milliseconds
+#define LVGL_PORT_TOUCH_MAX_POINTS              (2) // Touch points read per sample; LVGL gets the first, the rest
+                                                    // are available from `lvgl_port_touch_points()`
 
 /**
  *
@@ -161,6 +163,17 @@ bool lvgl_port_lock(int timeout_ms);
  */
 bool lvgl_port_unlock(void);
 
+/**
+ * @brief Get the touch points of the last sample read by the LVGL input driver, in display coordinates. LVGL itself
+ *        only sees the first one. Call it from the LVGL task or with the LVGL mutex held.
+ *
+ * @param points     Array that receives the points
+ * @param max_points Size of the array
+ *
+ * @return The number of points stored, 0 if the panel is not touched
+ */
+int lvgl_port_touch_points(lv_point_t *points, int max_points);
+
 #ifdef __cplusplus
 }
 #endif
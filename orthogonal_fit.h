@@ -0,0 +1,316 @@
+#pragma once
+
+#include <cmath>
+#include <utility>
+#include "eigen.cpp"
+
+// Model selection criteria for choosing a degree from nested fits
+enum class DegreeCriterion {
+    AIC,          // Akaike, corrected: n ln(RSS/n) + 2p + 2p(p+1)/(n-p-1)
+    BIC,          // Bayesian/Schwarz: n ln(RSS/n) + p ln(n)
+    AdjustedR2,   // 1 - (RSS/(n-p)) / (TSS/(n-1)), maximized
+    LeaveOneOut   // PRESS, the leave-one-out cross-validation error
+};
+
+// Least-squares polynomial fit in a basis of polynomials that are
+// orthonormal over the data points themselves (Forsythe's method, built
+// with the Stieltjes/Lanczos three-term recurrence).
+//
+// x is first mapped from the data range to t in [-1, 1]. Each basis
+// polynomial then follows from the previous two,
+//     b[k+1] q[k+1](t) = (t - a[k]) q[k](t) - g[k] q[k-1](t),
+// and its coefficient is one inner product with the residual, so no linear
+// system is formed. This sidesteps the ill-conditioned monomial normal
+// equations and stays accurate in float up to degree 20. Evaluation uses
+// Clenshaw's recurrence on the same a, b and g.
+//
+// With per-point weights w the basis is orthonormal under the weighted
+// inner product sum w f g instead. The per-point vectors then carry a
+// factor sqrt(w), and RSS, PRESS and the leverages are the weighted ones.
+template<int MaxDegree>
+class OrthogonalPolynomialFit {
+public:
+    OrthogonalPolynomialFit()
+        : degree_(-1), count_(0), weight_sum_(0.0f), center_(0.0f), inv_half_width_(1.0f),
+          q0_(0.0f) {}
+    
+    // Fit a polynomial of at most the given degree to count points with
+    // members x and y, optionally weighted by weights[0..count-1] >= 0.
+    // The degree is lowered when the points cannot support it (too few
+    // distinct x values with nonzero weight). Returns false if there are
+    // no points or all weights are zero.
+    template<typename PointT>
+    bool fit(const PointT* points, int count, int degree,
+             const float* weights = nullptr) {
+        degree_ = -1;
+        count_ = count;
+        if (count < 1) return false;
+        
+        float weight_sum = (float)count;
+        if (weights) {
+            weight_sum = 0.0f;
+            for (int i = 0; i < count; i++) {
+                weight_sum += weights[i];
+            }
+            if (!(weight_sum > 0.0f)) return false;
+        }
+        weight_sum_ = weight_sum;
+        degree = std::min(std::min(degree, MaxDegree), count - 1);
+        
+        // Map the data range to [-1, 1]
+        float min_x = points[0].x;
+        float max_x = points[0].x;
+        for (int i = 1; i < count; i++) {
+            min_x = std::min(min_x, points[i].x);
+            max_x = std::max(max_x, points[i].x);
+        }
+        float half_width = 0.5f * (max_x - min_x);
+        center_ = 0.5f * (min_x + max_x);
+        inv_half_width_ = half_width > 0.0f ? 1.0f / half_width : 1.0f;
+        
+        t_.resize(count);
+        q_prev_.resize(count);
+        q_.resize(count);
+        residual_.resize(count);
+        leverage_.resize(count);
+        leverage_.setZero();
+        
+        // q0 is the constant of unit norm
+        q0_ = 1.0f / std::sqrt(weight_sum);
+        for (int i = 0; i < count; i++) {
+            float sqrt_weight = weights ? std::sqrt(weights[i]) : 1.0f;
+            t_(i) = (points[i].x - center_) * inv_half_width_;
+            residual_(i) = sqrt_weight * points[i].y;
+            q_prev_(i) = 0.0f;
+            q_(i) = sqrt_weight * q0_;
+        }
+        g_[0] = 0.0f;
+        
+        for (int k = 0; ; k++) {
+            // Coefficient against the current residual (modified
+            // Gram-Schmidt) and a[k] = <t q[k], q[k]>
+            float c = 0.0f;
+            float a = 0.0f;
+            for (int i = 0; i < count; i++) {
+                float q = q_(i);
+                c += residual_(i) * q;
+                a += t_(i) * q * q;
+            }
+            // Update the residuals and the hat-matrix diagonal
+            // h_ii = sum_k q_k(t_i)^2. The leave-one-out residual is then
+            // r_i / (1 - h_ii), giving PRESS for this degree without refitting.
+            float residual_sq = 0.0f;
+            float press = 0.0f;
+            for (int i = 0; i < count; i++) {
+                float q = q_(i);
+                float r = residual_(i) - c * q;
+                float h = leverage_(i) + q * q;
+                residual_(i) = r;
+                leverage_(i) = h;
+                residual_sq += r * r;
+                float e = r / std::max(1.0f - h, kMinLeverageGap);
+                press += e * e;
+            }
+            coeffs_[k] = c;
+            rss_[k] = residual_sq;
+            press_[k] = press;
+            degree_ = k;
+            if (k == degree) {
+                a_[k] = a;
+                break;
+            }
+            
+            // Next basis vector. Its components along q[k] and q[k-1] are
+            // measured first and folded into a[k] and g[k] (one pass of
+            // reorthogonalization, which float needs at higher degrees);
+            // the vector is then built from the corrected coefficients, so
+            // evaluation reproduces exactly the vectors used here.
+            float g = g_[k];
+            float dot_q = 0.0f;
+            float dot_q_prev = 0.0f;
+            for (int i = 0; i < count; i++) {
+                float v = (t_(i) - a) * q_(i) - g * q_prev_(i);
+                dot_q += v * q_(i);
+                dot_q_prev += v * q_prev_(i);
+            }
+            a += dot_q;
+            g += dot_q_prev;
+            a_[k] = a;
+            g_[k] = g;
+            
+            float norm_sq = 0.0f;
+            for (int i = 0; i < count; i++) {
+                float v = (t_(i) - a) * q_(i) - g * q_prev_(i);
+                q_prev_(i) = v;
+                norm_sq += v * v;
+            }
+            
+            // Stop when the points cannot support a higher degree
+            float norm = std::sqrt(norm_sq);
+            if (!(norm > kMinNorm)) break;
+            
+            float inv_norm = 1.0f / norm;
+            for (int i = 0; i < count; i++) {
+                q_prev_(i) *= inv_norm;
+            }
+            b_[k + 1] = norm;
+            g_[k + 1] = norm;
+            std::swap(q_prev_, q_);
+        }
+        return true;
+    }
+    
+    // Degree actually fitted, -1 before the first fit
+    int degree() const { return degree_; }
+    
+    // The basis is nested, so one fit also holds the least-squares fits of
+    // every lower degree. Sum of squared residuals of the fit of degree d:
+    float residualSumOfSquares(int d) const { return rss_[d]; }
+    float residualSumOfSquares() const { return rss_[degree_]; }
+    
+    // Leave-one-out prediction error sum of squares (PRESS) of the fit of
+    // degree d; PRESS / n is the leave-one-out cross-validation error
+    float press(int d) const { return press_[d]; }
+    float press() const { return press_[degree_]; }
+    
+    // Hat-matrix diagonal (leverage of each point) of the fitted degree
+    const Eigen::VectorXf& leverage() const { return leverage_; }
+    
+    // Sum of the weights, the number of points when unweighted. Less the
+    // d + 1 coefficients, it is the residual degrees of freedom, and
+    // RSS(d) over those estimates the noise variance sigma^2.
+    float weightSum() const { return weight_sum_; }
+    
+    // Pick the degree in 1..degree() that minimizes the given criterion.
+    // Degrees that leave fewer than two residual degrees of freedom are not
+    // considered, since their residual says nothing about the noise.
+    int selectDegree(DegreeCriterion criterion) const {
+        if (degree_ < 1) return degree_;
+        float n = (float)count_;
+        float total_sq = rss_[0];
+        float floor_sq = std::max(total_sq * 1e-12f, 1e-30f);
+        int best = 1;
+        float best_score = 0.0f;
+        for (int d = 1; d <= degree_; d++) {
+            float params = (float)(d + 1);
+            if (d > 1 && count_ - (d + 1) < 2) break;
+            float rss = std::max(rss_[d], floor_sq);
+            float score;
+            switch (criterion) {
+                case DegreeCriterion::AIC:
+                    // Small-sample corrected AIC; plain AIC keeps choosing
+                    // near-interpolating degrees for a handful of points
+                    score = n * std::log(rss / n) + 2.0f * params
+                          + 2.0f * params * (params + 1.0f) / (n - params - 1.0f);
+                    break;
+                case DegreeCriterion::BIC:
+                    score = n * std::log(rss / n) + params * std::log(n);
+                    break;
+                case DegreeCriterion::LeaveOneOut:
+                    score = press_[d];
+                    break;
+                default:
+                    // Maximize adjusted R^2 by minimizing its complement
+                    score = total_sq > 0.0f && count_ > d + 1
+                          ? (rss / (n - params)) / (total_sq / (n - 1.0f))
+                          : 0.0f;
+                    break;
+            }
+            if (d == 1 || score < best_score) {
+                best = d;
+                best_score = score;
+            }
+        }
+        return best;
+    }
+    
+    // Value at x of the fitted polynomial truncated to degree d <= degree(),
+    // by Clenshaw's recurrence
+    float value(float x, int d) const {
+        if (d < 0) return 0.0f;
+        float t = (x - center_) * inv_half_width_;
+        float u1 = 0.0f;  // u[k+1]
+        float u2 = 0.0f;  // u[k+2]
+        for (int k = d; k >= 0; k--) {
+            float u = coeffs_[k];
+            if (k < d) u += (t - a_[k]) / b_[k + 1] * u1;
+            if (k + 1 < d) u -= g_[k + 1] / b_[k + 2] * u2;
+            u2 = u1;
+            u1 = u;
+        }
+        return q0_ * u1;
+    }
+    
+    float operator()(float x) const {
+        return value(x, degree_);
+    }
+    
+    // y[i] = p(x[i]) for i = 0..count-1, with p truncated to degree d
+    void evaluate(const float* x, float* y, int count, int d) const {
+        for (int i = 0; i < count; i++) {
+            y[i] = value(x[i], d);
+        }
+    }
+    
+    void evaluate(const float* x, float* y, int count) const {
+        evaluate(x, y, count, degree_);
+    }
+    
+    // As evaluate(), and in the same pass the leverage of each x: the
+    // variance of the fitted value there over sigma^2. The basis is
+    // orthonormal, so the coefficients' covariance is sigma^2 times the
+    // identity and the leverage is just the sum of the squared basis
+    // values, built up by the recurrence alongside the value.
+    void evaluate(const float* x, float* y, float* leverage, int count, int d) const {
+        for (int i = 0; i < count; i++) {
+            if (d < 0) {
+                y[i] = 0.0f;
+                leverage[i] = 0.0f;
+                continue;
+            }
+            float t = (x[i] - center_) * inv_half_width_;
+            float q_prev = 0.0f;
+            float q = q0_;
+            float value = coeffs_[0] * q;
+            float sum_sq = q * q;
+            for (int k = 0; k < d; k++) {
+                float next = ((t - a_[k]) * q - g_[k] * q_prev) / b_[k + 1];
+                q_prev = q;
+                q = next;
+                value += coeffs_[k + 1] * q;
+                sum_sq += q * q;
+            }
+            y[i] = value;
+            leverage[i] = sum_sq;
+        }
+    }
+    
+private:
+    static constexpr float kMinNorm = 1e-4f;
+    
+    // Points with leverage this close to 1 are interpolated; their
+    // leave-one-out residual is capped instead of dividing by zero
+    static constexpr float kMinLeverageGap = 1e-4f;
+    
+    int degree_;
+    int count_;
+    float weight_sum_;
+    float center_;
+    float inv_half_width_;
+    float q0_;
+    
+    // Recurrence coefficients and the coefficients of the fit
+    float a_[MaxDegree + 1];
+    float b_[MaxDegree + 1];
+    float g_[MaxDegree + 1];
+    float coeffs_[MaxDegree + 1];
+    float rss_[MaxDegree + 1];
+    float press_[MaxDegree + 1];
+    
+    // Per-point workspace, kept between fits
+    Eigen::VectorXf t_;
+    Eigen::VectorXf q_prev_;
+    Eigen::VectorXf q_;
+    Eigen::VectorXf residual_;
+    Eigen::VectorXf leverage_;
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "curve_tessellator.h"
+
+// Min/max decimation of a series: points stored in order of x, such as a
+// logged signal or a stream of touches from left to right.
+//
+// Drawn as one vertical span per pixel column, from the lowest to the
+// highest y among the points in that column, a series looks the same as
+// with every point joined up, however many points share a column. Finding
+// a column's points is a binary search on x. Their extremes come from a
+// pyramid of cached levels: level k holds the min and max of each block
+// of kFanout^(k+1) points, so any index range is covered by at most
+// 2 * kFanout entries per level. A full redraw then costs about
+// columns * log(n) steps instead of n.
+//
+// The pyramid does not keep the points. Every call takes the same array,
+// which must stay sorted by x; PointT is any struct with float x and y
+// members. Appending is amortized O(levels) per point.
+template<typename PointT>
+class SeriesEnvelope {
+public:
+    SeriesEnvelope() : size_(0) {}
+    
+    void clear() {
+        levels_.clear();
+        size_ = 0;
+    }
+    
+    // Points covered by the levels
+    size_t size() const { return size_; }
+    
+    // Extend the levels over points[size(), count)
+    void append(const PointT* points, size_t count) {
+        for (size_t i = size_; i < count; i++) {
+            float y = points[i].y;
+            size_t index = i;
+            for (size_t k = 0; k < levels_.size(); k++) {
+                index /= kFanout;
+                Level& level = levels_[k];
+                if (index == level.min.size()) {
+                    level.min.push_back(y);
+                    level.max.push_back(y);
+                } else {
+                    level.min[index] = std::min(level.min[index], y);
+                    level.max[index] = std::max(level.max[index], y);
+                }
+            }
+        }
+        size_ = std::max(size_, count);
+        
+        // A new level on top whenever the highest one outgrows a block
+        while (levelSize((int)levels_.size() - 1) > (size_t)kFanout) {
+            int below = (int)levels_.size() - 1;
+            size_t entries = (levelSize(below) + kFanout - 1) / kFanout;
+            Level level;
+            level.min.resize(entries);
+            level.max.resize(entries);
+            levels_.push_back(level);
+            for (size_t j = 0; j < entries; j++) {
+                rebuildEntry(points, (int)levels_.size() - 1, j);
+            }
+        }
+    }
+    
+    // Bring the levels up to date after points[index].y changed
+    void update(const PointT* points, size_t index) {
+        for (int k = 0; k < (int)levels_.size(); k++) {
+            index /= kFanout;
+            rebuildEntry(points, k, index);
+        }
+    }
+    
+    // Lowest and highest y over points[first, last), which must be covered
+    // by the levels. False if the range is empty.
+    bool range(const PointT* points, size_t first, size_t last, float& y_min, float& y_max) const {
+        if (first >= last) return false;
+        y_min = INFINITY;
+        y_max = -INFINITY;
+        
+        // Whole blocks are taken from the level above, the rest one by one
+        int k = -1;
+        while (first < last) {
+            if (k + 1 < (int)levels_.size()) {
+                while (first < last && first % kFanout) {
+                    include(points, k, first++, y_min, y_max);
+                }
+                while (first < last && last % kFanout) {
+                    include(points, k, --last, y_min, y_max);
+                }
+                first /= kFanout;
+                last /= kFanout;
+                k++;
+            } else {
+                while (first < last) {
+                    include(points, k, first++, y_min, y_max);
+                }
+            }
+        }
+        return true;
+    }
+    
+    // Call f(column, first, last, y_min, y_max) for each of the columns
+    // that holds points, where column c spans x from x0 + c * width to
+    // x0 + (c + 1) * width and holds points[first, last)
+    template<typename F>
+    void forEachColumn(const PointT* points, float x0, float width, int columns, F f) const {
+        const PointT* end = points + size_;
+        const PointT* first = lowerBound(points, end, x0);
+        for (int c = 0; c < columns && first != end; c++) {
+            const PointT* last = lowerBound(first, end, x0 + (c + 1) * width);
+            float y_min, y_max;
+            if (range(points, first - points, last - points, y_min, y_max)) {
+                f(c, (size_t)(first - points), (size_t)(last - points), y_min, y_max);
+            }
+            first = last;
+        }
+    }
+
+private:
+    // Points per block of the first level, and blocks per block above
+    static const int kFanout = 16;
+    
+    struct Level {
+        std::vector<float> min;
+        std::vector<float> max;
+    };
+    
+    // Entries of level k, where level -1 is the points themselves
+    size_t levelSize(int k) const {
+        return k < 0 ? size_ : levels_[k].min.size();
+    }
+    
+    void include(const PointT* points, int k, size_t index, float& y_min, float& y_max) const {
+        if (k < 0) {
+            y_min = std::min(y_min, points[index].y);
+            y_max = std::max(y_max, points[index].y);
+        } else {
+            y_min = std::min(y_min, levels_[k].min[index]);
+            y_max = std::max(y_max, levels_[k].max[index]);
+        }
+    }
+    
+    // Recompute entry j of level k from its block of the level below
+    void rebuildEntry(const PointT* points, int k, size_t j) {
+        float y_min = INFINITY;
+        float y_max = -INFINITY;
+        size_t begin = j * kFanout;
+        size_t end = std::min(begin + kFanout, levelSize(k - 1));
+        for (size_t i = begin; i < end; i++) {
+            include(points, k - 1, i, y_min, y_max);
+        }
+        levels_[k].min[j] = y_min;
+        levels_[k].max[j] = y_max;
+    }
+    
+    static const PointT* lowerBound(const PointT* first, const PointT* last, float x) {
+        return std::lower_bound(first, last, x,
+                                [](const PointT& point, float value) { return point.x < value; });
+    }
+    
+    std::vector<Level> levels_;
+    size_t size_;
+};
+
+// Count of points per canvas pixel, for drawing a scatter plot too dense
+// for dots as a heat map instead.
+//
+// The grid covers the clip rectangle of a PlotMapping, one bin per pixel.
+// Points are binned once, as they are added; drawing it only walks the
+// bins. Each row remembers the span of columns it has ever counted in, so
+// sparse data is walked quickly too. Counts saturate at 65535 and are
+// shown on a log scale: each doubling of the count is one step of
+// opacity, up to fully opaque for the fullest bin.
+class DensityGrid {
+public:
+    DensityGrid() : width_(0), height_(0) {
+        mapping_ = PlotMapping();
+    }
+    
+    // Empty the grid and size it to the clip rectangle of mapping
+    void reset(const PlotMapping& mapping) {
+        mapping_ = mapping;
+        width_ = std::max((int)(mapping.right - mapping.left) + 1, 0);
+        height_ = std::max((int)(mapping.bottom - mapping.top) + 1, 0);
+        counts_.assign((size_t)width_ * height_, 0);
+        row_first_.assign(height_, width_);
+        row_last_.assign(height_, -1);
+    }
+    
+    // Count the point (x, y), in world coordinates, if it is in the grid
+    void add(float x, float y) {
+        int column, row;
+        if (!bin(x, y, column, row)) return;
+        uint16_t& count = counts_[(size_t)row * width_ + column];
+        if (count < UINT16_MAX) count++;
+        row_first_[row] = std::min(row_first_[row], column);
+        row_last_[row] = std::max(row_last_[row], column);
+    }
+    
+    // Take back a point counted by add()
+    void remove(float x, float y) {
+        int column, row;
+        if (!bin(x, y, column, row)) return;
+        uint16_t& count = counts_[(size_t)row * width_ + column];
+        if (count > 0 && count < UINT16_MAX) count--;
+    }
+    
+    // Columns of row counted in at some point, or false if none. The
+    // grid's pixel (0, 0) is the top left corner of the clip rectangle.
+    bool rowExtent(int row, int& first, int& last) const {
+        first = row_first_[row];
+        last = row_last_[row];
+        return first <= last;
+    }
+    
+    int width() const { return width_; }
+    int height() const { return height_; }
+    
+    // Call f(column, row, alpha) for every bin holding points, with alpha
+    // in 1..32 for the blend onto the canvas
+    template<typename F>
+    void forEachBin(F f) const {
+        uint16_t fullest = 0;
+        for (int row = 0; row < height_; row++) {
+            const uint16_t* counts = &counts_[(size_t)row * width_];
+            for (int column = row_first_[row]; column <= row_last_[row]; column++) {
+                fullest = std::max(fullest, counts[column]);
+            }
+        }
+        if (!fullest) return;
+        
+        // With one point in every bin, they are all the fullest
+        int steps = bitLength(fullest) - 1;
+        uint8_t alphas[17];
+        for (int bits = 1; bits <= 16; bits++) {
+            alphas[bits] = steps ? kMinAlpha + std::min(bits - 1, steps) * (32 - kMinAlpha) / steps
+                                 : 32;
+        }
+        for (int row = 0; row < height_; row++) {
+            const uint16_t* counts = &counts_[(size_t)row * width_];
+            for (int column = row_first_[row]; column <= row_last_[row]; column++) {
+                if (counts[column]) f(column, row, (uint32_t)alphas[bitLength(counts[column])]);
+            }
+        }
+    }
+
+private:
+    // Opacity of a bin with a single point, out of 32
+    static const int kMinAlpha = 10;
+    
+    static int bitLength(uint16_t count) {
+        return 32 - __builtin_clz((uint32_t)count);
+    }
+    
+    bool bin(float x, float y, int& column, int& row) const {
+        float px = mapping_.pixelX(x) - mapping_.left;
+        float py = mapping_.pixelY(y) - mapping_.top;
+        if (!(px > -0.5f && px < width_ - 0.5f && py > -0.5f && py < height_ - 0.5f)) {
+            return false;
+        }
+        column = (int)(px + 0.5f);
+        row = (int)(py + 0.5f);
+        return true;
+    }
+    
+    PlotMapping mapping_;
+    int width_;
+    int height_;
+    std::vector<uint16_t> counts_;
+    std::vector<int> row_first_;
+    std::vector<int> row_last_;
+};
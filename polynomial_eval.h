@@ -0,0 +1,85 @@
+#pragma once
+
+// Batch polynomial evaluation with Horner's scheme.
+//
+// Inputs and outputs are plain float arrays (structure of arrays), so the
+// x values can be processed several at a time: 8 per step with AVX, 4 with
+// SSE on the host. The ESP32-S3 vector unit has no float lanes, so there
+// the generic path runs four independent Horner chains per step, which
+// keeps the pipelined FPU busy with fused multiply-adds (madd.s).
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define POLYNOMIAL_EVAL_AVX   1
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define POLYNOMIAL_EVAL_SSE   1
+#endif
+
+// Value of coeffs[0] + coeffs[1] * x + ... + coeffs[degree] * x^degree
+inline float evaluatePolynomial(const float* coeffs, int degree, float x) {
+    float y = coeffs[degree];
+    for (int k = degree - 1; k >= 0; k--) {
+        y = y * x + coeffs[k];
+    }
+    return y;
+}
+
+// y[i] = p(x[i]) for i = 0..count-1. x and y may be the same array.
+inline void evaluatePolynomial(const float* coeffs, int degree,
+                               const float* x, float* y, int count) {
+    int i = 0;
+    
+#if defined(POLYNOMIAL_EVAL_AVX)
+    for (; i + 8 <= count; i += 8) {
+        __m256 xv = _mm256_loadu_ps(x + i);
+        __m256 acc = _mm256_set1_ps(coeffs[degree]);
+        for (int k = degree - 1; k >= 0; k--) {
+#if defined(__FMA__)
+            acc = _mm256_fmadd_ps(acc, xv, _mm256_set1_ps(coeffs[k]));
+#else
+            acc = _mm256_add_ps(_mm256_mul_ps(acc, xv), _mm256_set1_ps(coeffs[k]));
+#endif
+        }
+        _mm256_storeu_ps(y + i, acc);
+    }
+#elif defined(POLYNOMIAL_EVAL_SSE)
+    for (; i + 4 <= count; i += 4) {
+        __m128 xv = _mm_loadu_ps(x + i);
+        __m128 acc = _mm_set1_ps(coeffs[degree]);
+        for (int k = degree - 1; k >= 0; k--) {
+            acc = _mm_add_ps(_mm_mul_ps(acc, xv), _mm_set1_ps(coeffs[k]));
+        }
+        _mm_storeu_ps(y + i, acc);
+    }
+#endif
+    
+    // Four interleaved chains hide the multiply-add latency
+    for (; i + 4 <= count; i += 4) {
+        float x0 = x[i], x1 = x[i + 1], x2 = x[i + 2], x3 = x[i + 3];
+        float c = coeffs[degree];
+        float y0 = c, y1 = c, y2 = c, y3 = c;
+        for (int k = degree - 1; k >= 0; k--) {
+            c = coeffs[k];
+            y0 = y0 * x0 + c;
+            y1 = y1 * x1 + c;
+            y2 = y2 * x2 + c;
+            y3 = y3 * x3 + c;
+        }
+        y[i] = y0;
+        y[i + 1] = y1;
+        y[i + 2] = y2;
+        y[i + 3] = y3;
+    }
+    
+    for (; i < count; i++) {
+        y[i] = evaluatePolynomial(coeffs, degree, x[i]);
+    }
+}
+
+// Evenly spaced x[i] = start + i * step, e.g. to sample a curve
+inline void fillLinear(float start, float step, float* x, int count) {
+    for (int i = 0; i < count; i++) {
+        x[i] = start + i * step;
+    }
+}
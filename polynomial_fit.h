@@ -0,0 +1,617 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "eigen.cpp"
+#include "polynomial_eval.h"
+
+// Running power sums of a point set: sum(x^k) for k = 0..2*MaxDegree,
+// sum(x^k * y) for k = 0..MaxDegree and sum(y^2). They are all the normal
+// equations of a polynomial fit need, so a fit of any degree up to
+// MaxDegree costs only the small Hankel solve, however many points were
+// collected. Moments of disjoint point sets add up, which is what k-fold
+// cross-validation below relies on.
+//
+// Each sum is kept as a float plus the rounding error it has accumulated
+// (Neumaier's compensated summation), and the powers x^k carry their own
+// rounding error along, formed with fused multiply-adds. The float sums
+// alone are exactly what plain accumulation would give; together with
+// the error terms they are good to about twice float precision, which
+// MomentPrecision::Mixed uses to refine the solution.
+template<int MaxDegree>
+class PolynomialMoments {
+public:
+    PolynomialMoments() {
+        clear();
+    }
+    
+    void clear() {
+        count_ = 0;
+        sum_yy_ = 0.0f;
+        sum_yy_error_ = 0.0f;
+        for (int k = 0; k <= 2 * MaxDegree; k++) {
+            sum_xk_[k] = 0.0f;
+            sum_xk_error_[k] = 0.0f;
+        }
+        for (int k = 0; k <= MaxDegree; k++) {
+            sum_xky_[k] = 0.0f;
+            sum_xky_error_[k] = 0.0f;
+        }
+    }
+    
+    void add(float x, float y) {
+        accumulate(x, y, 1.0f);
+        count_++;
+    }
+    
+    // Undo a previous add() of the same point
+    void remove(float x, float y) {
+        accumulate(x, y, -1.0f);
+        count_--;
+    }
+    
+    // Combine with the moments of another point set, or take them out again
+    PolynomialMoments& operator+=(const PolynomialMoments& other) {
+        combine(other, 1.0f);
+        count_ += other.count_;
+        return *this;
+    }
+    
+    PolynomialMoments& operator-=(const PolynomialMoments& other) {
+        combine(other, -1.0f);
+        count_ -= other.count_;
+        return *this;
+    }
+    
+    int count() const { return count_; }
+    
+    // sum(x^k), k <= 2 * MaxDegree
+    float sumXk(int k) const { return sum_xk_[k]; }
+    const float* sumXk() const { return sum_xk_; }
+    
+    // sum(x^k * y), k <= MaxDegree
+    float sumXkY(int k) const { return sum_xky_[k]; }
+    const float* sumXkY() const { return sum_xky_; }
+    
+    float sumYY() const { return sum_yy_; }
+    
+    // Rounding error of each float sum above: the exact sum is closer to
+    // the float sum plus this
+    float sumXkError(int k) const { return sum_xk_error_[k]; }
+    float sumXkYError(int k) const { return sum_xky_error_[k]; }
+    
+    // Residual A^T y - A^T A c of the normal equations for the polynomial
+    // coeffs[0..Degree], from the compensated sums in double-float
+    // arithmetic, so it is accurate even where it is a small difference of
+    // large terms
+    template<int Degree>
+    void normalResidual(const float* coeffs, float* residual) const {
+        normalResidual<Degree>(coeffs, sum_xky_, sum_xky_error_, residual);
+    }
+    
+    // The same for another right-hand side, taken as exact:
+    // rhs - A^T A c
+    template<int Degree>
+    void normalResidual(const float* coeffs, const float* rhs, float* residual) const {
+        normalResidual<Degree>(coeffs, rhs, nullptr, residual);
+    }
+    
+    // Sum of squared residuals of the polynomial coeffs[0..degree] over
+    // these points: sum(y^2) - 2 c^T A^T y + c^T A^T A c. At degree 4-5
+    // the three terms are orders of magnitude larger than their difference,
+    // so it is formed in double from the compensated sums; that is (d+1)^2
+    // software multiply-adds on the ESP32-S3, still no pass over the points.
+    float squaredError(const float* coeffs, int degree) const {
+        double cross = 0.0;
+        double quad = 0.0;
+        for (int i = 0; i <= degree; i++) {
+            cross += (double)coeffs[i] * ((double)sum_xky_[i] + sum_xky_error_[i]);
+            double row = 0.0;
+            for (int j = 0; j <= degree; j++) {
+                row += ((double)sum_xk_[i + j] + sum_xk_error_[i + j]) * coeffs[j];
+            }
+            quad += (double)coeffs[i] * row;
+        }
+        double sum_yy = (double)sum_yy_ + sum_yy_error_;
+        return (float)std::max(sum_yy - 2.0 * cross + quad, 0.0);
+    }
+    
+    // Normal equations A^T A c = A^T y of a fit of the given degree, from
+    // the float sums or, with compensated set, from the sums plus their
+    // rounding errors
+    template<int Degree, typename T>
+    void normalEquations(Eigen::Matrix<T, Degree + 1, Degree + 1>& ATA,
+                         Eigen::Vector<T, Degree + 1>& ATy,
+                         bool compensated = false) const {
+        static_assert(Degree <= MaxDegree, "Degree exceeds the accumulated moments");
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            EIGEN_UNROLL
+            for (int j = 0; j <= Degree; j++) {
+                ATA(i, j) = compensated ? T(sum_xk_[i + j]) + T(sum_xk_error_[i + j])
+                                        : T(sum_xk_[i + j]);
+            }
+            ATy(i) = compensated ? T(sum_xky_[i]) + T(sum_xky_error_[i]) : T(sum_xky_[i]);
+        }
+    }
+    
+private:
+    // rhs + rhs_error - A^T A c, for normalResidual()
+    template<int Degree>
+    void normalResidual(const float* coeffs, const float* rhs, const float* rhs_error,
+                        float* residual) const {
+        static_assert(Degree <= MaxDegree, "Degree exceeds the accumulated moments");
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            float sum = rhs[i];
+            float error = rhs_error ? rhs_error[i] : 0.0f;
+            EIGEN_UNROLL
+            for (int j = 0; j <= Degree; j++) {
+                float product = sum_xk_[i + j] * coeffs[j];
+                float product_error = std::fma(sum_xk_[i + j], coeffs[j], -product);
+                addCompensated(sum, error, -product);
+                error -= product_error + sum_xk_error_[i + j] * coeffs[j];
+            }
+            residual[i] = sum + error;
+        }
+    }
+    
+    // sum += value, with the rounding error of the addition added to error
+    // (Neumaier's variant of Kahan summation, which also holds when value
+    // is the larger term)
+    static void addCompensated(float& sum, float& error, float value) {
+        float t = sum + value;
+        if (std::fabs(sum) >= std::fabs(value)) {
+            error += (sum - t) + value;
+        } else {
+            error += (value - t) + sum;
+        }
+        sum = t;
+    }
+    
+    void accumulate(float x, float y, float weight) {
+        // x^k as xk + xk_error, extended by one exact product per power
+        float xk = weight;
+        float xk_error = 0.0f;
+        EIGEN_UNROLL
+        for (int k = 0; k <= 2 * MaxDegree; k++) {
+            addCompensated(sum_xk_[k], sum_xk_error_[k], xk);
+            sum_xk_error_[k] += xk_error;
+            if (k <= MaxDegree) {
+                float xky = xk * y;
+                addCompensated(sum_xky_[k], sum_xky_error_[k], xky);
+                sum_xky_error_[k] += std::fma(xk, y, -xky) + xk_error * y;
+            }
+            float next = xk * x;
+            xk_error = std::fma(xk, x, -next) + xk_error * x;
+            xk = next;
+        }
+        float yy = weight * y * y;
+        addCompensated(sum_yy_, sum_yy_error_, yy);
+    }
+    
+    void combine(const PolynomialMoments& other, float sign) {
+        for (int k = 0; k <= 2 * MaxDegree; k++) {
+            addCompensated(sum_xk_[k], sum_xk_error_[k], sign * other.sum_xk_[k]);
+            sum_xk_error_[k] += sign * other.sum_xk_error_[k];
+        }
+        for (int k = 0; k <= MaxDegree; k++) {
+            addCompensated(sum_xky_[k], sum_xky_error_[k], sign * other.sum_xky_[k]);
+            sum_xky_error_[k] += sign * other.sum_xky_error_[k];
+        }
+        addCompensated(sum_yy_, sum_yy_error_, sign * other.sum_yy_);
+        sum_yy_error_ += sign * other.sum_yy_error_;
+    }
+    
+    int count_;
+    float sum_yy_;
+    float sum_yy_error_;
+    float sum_xk_[2 * MaxDegree + 1];
+    float sum_xk_error_[2 * MaxDegree + 1];
+    float sum_xky_[MaxDegree + 1];
+    float sum_xky_error_[MaxDegree + 1];
+};
+
+// How fitPolynomial() solves the normal equations
+enum class MomentSolver {
+    LU,       // Assemble the Hankel matrix, Gaussian elimination, O(d^3)
+    Hankel    // Structured solve straight from the moments, O(d^2)
+};
+
+// Arithmetic fitPolynomial() solves in. Double is emulated in software on
+// the ESP32-S3, an order of magnitude slower than the float unit; Mixed
+// gets most of its accuracy for a few more float solves.
+enum class MomentPrecision {
+    Float,    // Float sums, one float solve
+    Mixed,    // Compensated sums, float solve, then kRefinementPasses of
+              // iterative refinement with double-float residuals
+    Double    // Compensated sums widened to double, double solve
+};
+
+// Solve the positive definite Hankel system H c = rhs with H(i, j) = mu[i + j],
+// i.e. the normal equations of a polynomial fit of the given degree, from
+// the moments mu[0..2*Degree] and rhs[0..Degree] alone.
+//
+// This is Chebyshev's algorithm: the mixed moments sigma(k, l) = <p_k, x^l>
+// of the monic polynomials p_k orthogonal under the moments yield the
+// recurrence p_{k+1} = (x - alpha_k) p_k - beta_k p_{k-1} in O(d^2), and
+// the solution is sum_k <y, p_k> / <p_k, p_k> * p_k. Polynomials whose norm
+// is not positive (too few distinct x values) end the expansion, leaving
+// the remaining coefficients at zero.
+template<int Degree, typename T>
+void solveHankel(const T* mu, const T* rhs, T* coeffs) {
+    const int N = Degree + 1;
+    const int M = 2 * Degree + 1;
+    
+    // sigma(k-1, l) and sigma(k, l), and the monomial coefficients of
+    // p_{k-1} and p_k
+    T sigma_prev[M] = {};
+    T sigma[M];
+    T p_prev[N] = {};
+    T p[N] = {};
+    T alpha_prev_term = T(0);
+    T norm_prev = T(1);
+    
+    EIGEN_UNROLL
+    for (int l = 0; l < M; l++) {
+        sigma[l] = mu[l];
+    }
+    p[0] = T(1);
+    
+    EIGEN_UNROLL
+    for (int i = 0; i < N; i++) {
+        coeffs[i] = T(0);
+    }
+    
+    EIGEN_UNROLL
+    for (int k = 0; k < N; k++) {
+        T norm = sigma[k];
+        if (!(norm > T(0))) break;
+        
+        // Project y onto p_k and add its contribution
+        T proj = T(0);
+        EIGEN_UNROLL
+        for (int j = 0; j <= k; j++) {
+            proj += p[j] * rhs[j];
+        }
+        T c = proj / norm;
+        EIGEN_UNROLL
+        for (int j = 0; j <= k; j++) {
+            coeffs[j] += c * p[j];
+        }
+        if (k == Degree) break;
+        
+        // Recurrence coefficients and the next mixed moments and polynomial
+        T alpha_term = sigma[k + 1] / norm;
+        T alpha = alpha_term - alpha_prev_term;
+        T beta = k > 0 ? norm / norm_prev : T(0);
+        
+        EIGEN_UNROLL
+        for (int l = k + 1; l < M - k - 1; l++) {
+            T next = sigma[l + 1] - alpha * sigma[l] - beta * sigma_prev[l];
+            sigma_prev[l] = sigma[l];
+            sigma[l] = next;
+        }
+        
+        EIGEN_UNROLL
+        for (int j = k + 1; j > 0; j--) {
+            T next = p[j - 1] - alpha * p[j] - beta * p_prev[j];
+            p_prev[j] = p[j];
+            p[j] = next;
+        }
+        T next0 = -alpha * p[0] - beta * p_prev[0];
+        p_prev[0] = p[0];
+        p[0] = next0;
+        
+        alpha_prev_term = alpha_term;
+        norm_prev = norm;
+    }
+}
+
+// Residual-correction passes of MomentPrecision::Mixed. The first removes
+// nearly all of the float solve's error; the second helps at degree 5.
+const int kRefinementPasses = 2;
+
+// Normal equations of a fit of the given degree, assembled in type T and
+// prepared for the given solver once, then solved for any right-hand side
+template<int Degree, typename T>
+class NormalEquationSolver {
+public:
+    template<int MaxDegree>
+    NormalEquationSolver(const PolynomialMoments<MaxDegree>& moments,
+                         MomentSolver solver, bool compensated)
+        : solver_(solver) {
+        Eigen::Matrix<T, Degree + 1, Degree + 1> ATA;
+        moments.template normalEquations<Degree>(ATA, ATy_, compensated);
+        
+        // The first row and the last column hold every moment
+        EIGEN_UNROLL
+        for (int k = 0; k <= 2 * Degree; k++) {
+            mu_[k] = k <= Degree ? ATA(0, k) : ATA(k - Degree, Degree);
+        }
+        if (solver != MomentSolver::LU) return;
+        
+        // The LU factors D A^T A D, with D about the inverse square roots
+        // of the diagonal, so that its pivot threshold, relative to the
+        // largest entry, does not discard the small pivots of the high
+        // powers. Powers of two scale without rounding.
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            int exponent = 0;
+            if (ATA(i, i) > T(0)) std::frexp(ATA(i, i), &exponent);
+            scale_[i] = std::ldexp(T(1), -exponent / 2);
+        }
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            EIGEN_UNROLL
+            for (int j = 0; j <= Degree; j++) {
+                ATA(i, j) *= scale_[i] * scale_[j];
+            }
+        }
+        lu_ = ATA.partialPivLu();
+    }
+    
+    // Solution for the moments' own right-hand side A^T y
+    void solve(T* coeffs) const { solve(ATy_.data(), coeffs); }
+    
+    void solve(const T* rhs, T* coeffs) const {
+        if (solver_ == MomentSolver::Hankel) {
+            solveHankel<Degree>(mu_, rhs, coeffs);
+            return;
+        }
+        Eigen::Vector<T, Degree + 1> b;
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            b(i) = rhs[i] * scale_[i];
+        }
+        Eigen::Vector<T, Degree + 1> c = lu_.solve(b);
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            coeffs[i] = c(i) * scale_[i];
+        }
+    }
+    
+private:
+    MomentSolver solver_;
+    T mu_[2 * Degree + 1];
+    Eigen::Vector<T, Degree + 1> ATy_;
+    T scale_[Degree + 1];
+    typename Eigen::Matrix<T, Degree + 1, Degree + 1>::PartialPivLU lu_;
+};
+
+// Coefficient covariance of a monomial fit, up to the noise variance
+// sigma^2, kept as the leverage at any x: the variance of the fitted value
+// there over sigma^2, phi(x)^T (A^T A)^-1 phi(x) with
+// phi(x) = (1, x, ..., x^d).
+//
+// In powers of x that quadratic form is a small difference of huge terms,
+// so it is kept in t = (x - center) * inv_scale instead, where center and
+// 1 / inv_scale are the mean and standard deviation of the points' x. It
+// is folded into one polynomial of degree 2d in t, so the leverage of a
+// batch of x values is one Horner pass, like the curve itself.
+template<int MaxDegree>
+struct PolynomialCovariance {
+    int degree;
+    float center;
+    float inv_scale;
+    float leverage[2 * MaxDegree + 1];
+    
+    PolynomialCovariance() : degree(-1), center(0.0f), inv_scale(1.0f) {}
+    
+    // h[i] = leverage at x[i] for i = 0..count-1. x and h may be the same
+    // array.
+    void evaluate(const float* x, float* h, int count) const {
+        for (int i = 0; i < count; i++) {
+            h[i] = (x[i] - center) * inv_scale;
+        }
+        evaluatePolynomial(leverage, std::max(2 * degree, 0), h, h, count);
+    }
+};
+
+// Covariance of the fit whose normal equations are factored in equations,
+// without forming (A^T A)^-1: the factorization solves for M, whose
+// column k holds the coefficients of t^k in each power of x, and the
+// covariance in t is M^T (A^T A)^-1 M. With refine, each column gets the
+// same residual correction as the coefficients.
+template<int Degree, typename T, int MaxDegree>
+void solveCovariance(const NormalEquationSolver<Degree, T>& equations,
+                     const PolynomialMoments<MaxDegree>& moments, bool refine,
+                     PolynomialCovariance<MaxDegree>& covariance) {
+    // In double from the compensated sums: for x far from 0, E[x^2] and
+    // mean^2 agree in more digits than a float holds
+    double n = moments.count();
+    double mean = ((double)moments.sumXk(1) + moments.sumXkError(1)) / n;
+    double spread = ((double)moments.sumXk(2) + moments.sumXkError(2)) / n - mean * mean;
+    float scale = spread > 0.0 ? (float)std::sqrt(spread) : 1.0f;
+    
+    // x^i = (center + scale t)^i, expanded binomially
+    T m[Degree + 1][Degree + 1];
+    for (int i = 0; i <= Degree; i++) {
+        T binomial = 1;
+        for (int k = 0; k <= Degree; k++) {
+            m[i][k] = k <= i ? binomial * std::pow((T)mean, i - k) * std::pow((T)scale, k) : 0;
+            binomial = binomial * (i - k) / (k + 1);
+        }
+    }
+    
+    T solved[Degree + 1][Degree + 1];
+    for (int k = 0; k <= Degree; k++) {
+        T rhs[Degree + 1];
+        for (int i = 0; i <= Degree; i++) {
+            rhs[i] = m[i][k];
+        }
+        equations.solve(rhs, solved[k]);
+        if (!refine) continue;
+        for (int pass = 0; pass < kRefinementPasses; pass++) {
+            float column[Degree + 1];
+            float exact[Degree + 1];
+            float residual[Degree + 1];
+            T correction[Degree + 1];
+            for (int i = 0; i <= Degree; i++) {
+                column[i] = (float)solved[k][i];
+                exact[i] = (float)rhs[i];
+            }
+            moments.template normalResidual<Degree>(column, exact, residual);
+            T residual_t[Degree + 1];
+            for (int i = 0; i <= Degree; i++) {
+                residual_t[i] = residual[i];
+            }
+            equations.solve(residual_t, correction);
+            for (int i = 0; i <= Degree; i++) {
+                solved[k][i] += correction[i];
+            }
+        }
+    }
+    
+    // Entry (a, b) of the covariance in t multiplies t^(a + b)
+    covariance.degree = Degree;
+    covariance.center = (float)mean;
+    covariance.inv_scale = 1.0f / scale;
+    std::fill(covariance.leverage, covariance.leverage + 2 * MaxDegree + 1, 0.0f);
+    for (int a = 0; a <= Degree; a++) {
+        for (int b = 0; b <= Degree; b++) {
+            T entry = 0;
+            for (int i = 0; i <= Degree; i++) {
+                entry += m[i][a] * solved[b][i];
+            }
+            covariance.leverage[a + b] += (float)entry;
+        }
+    }
+}
+
+// Least-squares polynomial of a fixed degree from accumulated moments,
+// solved on the stack. Coefficients above Degree are set to zero. With
+// covariance, the same factorization also gives the coefficients'
+// covariance.
+template<int Degree, int MaxDegree>
+void fitPolynomial(const PolynomialMoments<MaxDegree>& moments,
+                   Eigen::Vector<float, MaxDegree + 1>& coeffs,
+                   MomentSolver solver = MomentSolver::LU,
+                   MomentPrecision precision = MomentPrecision::Float,
+                   PolynomialCovariance<MaxDegree>* covariance = nullptr) {
+    coeffs.setZero();
+    
+    if (precision == MomentPrecision::Double) {
+        double c[Degree + 1];
+        NormalEquationSolver<Degree, double> equations(moments, solver, true);
+        equations.solve(c);
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            coeffs(i) = (float)c[i];
+        }
+        if (covariance) solveCovariance(equations, moments, false, *covariance);
+        return;
+    }
+    
+    bool mixed = precision == MomentPrecision::Mixed;
+    NormalEquationSolver<Degree, float> equations(moments, solver, mixed);
+    equations.solve(coeffs.data());
+    if (covariance) solveCovariance(equations, moments, mixed, *covariance);
+    if (!mixed) return;
+    
+    // Iterative refinement: the float factorization solves for the
+    // correction from the residual, which the compensated sums give to
+    // about twice float precision
+    for (int pass = 0; pass < kRefinementPasses; pass++) {
+        float residual[Degree + 1];
+        float correction[Degree + 1];
+        moments.template normalResidual<Degree>(coeffs.data(), residual);
+        equations.solve(residual, correction);
+        EIGEN_UNROLL
+        for (int i = 0; i <= Degree; i++) {
+            coeffs(i) += correction[i];
+        }
+    }
+}
+
+// Points per partial sum of the squared errors below. As in the QR, the
+// blocks keep the float rounding error from growing with the point count.
+const int kSquaredErrorBlock = 128;
+
+// Sum of squared residuals of the polynomial coeffs[0..degree] over count
+// points with members x and y, in one pass over them
+template<typename PointT>
+float squaredError(const PointT* points, int count, const float* coeffs, int degree) {
+    double sum = 0.0;
+    for (int i0 = 0; i0 < count; i0 += kSquaredErrorBlock) {
+        int i1 = std::min(count, i0 + kSquaredErrorBlock);
+        float block = 0.0f;
+        for (int i = i0; i < i1; i++) {
+            float r = points[i].y - evaluatePolynomial(coeffs, degree, points[i].x);
+            block += r * r;
+        }
+        sum += block;
+    }
+    return (float)sum;
+}
+
+// k-fold cross-validation error (mean squared prediction error) of a fit
+// of the given degree, for folds that split points by index, point i
+// going to folds[i % Folds]. Each fold is predicted by the fit to the
+// moments of all other folds, so the training costs k small solves. The
+// held-out points are scored on their own: over a wide x range at degree
+// 5, the moment form of a fold's error is a difference of terms too large
+// for even the compensated sums to resolve. To bound the cost of a large
+// set, the count points given can be every stride-th of those the folds
+// were built from, point j standing for point j * stride; a stride that
+// shares no factor with Folds samples every fold. Returns NAN when some
+// training set has too few points for the degree.
+template<int Degree, int MaxDegree, int Folds, typename PointT>
+float kFoldError(const PolynomialMoments<MaxDegree> (&folds)[Folds],
+                 const PointT* points, int count,
+                 MomentSolver solver = MomentSolver::LU,
+                 MomentPrecision precision = MomentPrecision::Float,
+                 int stride = 1) {
+    PolynomialMoments<MaxDegree> total;
+    for (int f = 0; f < Folds; f++) {
+        total += folds[f];
+    }
+    if (count == 0) return NAN;
+    
+    // Each fold's prediction, from the fit to all the other folds
+    float fold_coeffs[Folds][Degree + 1] = {};
+    Eigen::Vector<float, MaxDegree + 1> coeffs;
+    for (int f = 0; f < Folds; f++) {
+        if (folds[f].count() == 0) continue;
+        PolynomialMoments<MaxDegree> training = total;
+        training -= folds[f];
+        if (training.count() < Degree + 1) return NAN;
+        
+        fitPolynomial<Degree>(training, coeffs, solver, precision);
+        std::copy(coeffs.data(), coeffs.data() + Degree + 1, fold_coeffs[f]);
+    }
+    
+    int fold_step = stride % Folds;
+    double squared_error = 0.0;
+    int fold = 0;
+    for (int i0 = 0; i0 < count; i0 += kSquaredErrorBlock) {
+        int i1 = std::min(count, i0 + kSquaredErrorBlock);
+        float block = 0.0f;
+        for (int i = i0; i < i1; i++) {
+            float r = points[i].y - evaluatePolynomial(fold_coeffs[fold], Degree, points[i].x);
+            block += r * r;
+            fold += fold_step;
+            if (fold >= Folds) fold -= Folds;
+        }
+        squared_error += block;
+    }
+    return (float)(squared_error / count);
+}
+
+// Two-sided 95% critical value of Student's t with the given degrees of
+// freedom (at least 1): tabulated up to 30, then the Cornish-Fisher
+// expansion around the normal quantile, good to 1e-4 there
+inline float studentT95(int dof) {
+    static const float kTable[30] = {
+        12.706f, 4.303f, 3.182f, 2.776f, 2.571f, 2.447f, 2.365f, 2.306f, 2.262f, 2.228f,
+        2.201f, 2.179f, 2.160f, 2.145f, 2.131f, 2.120f, 2.110f, 2.101f, 2.093f, 2.086f,
+        2.080f, 2.074f, 2.069f, 2.064f, 2.060f, 2.056f, 2.052f, 2.048f, 2.045f, 2.042f
+    };
+    if (dof <= 30) return kTable[std::max(dof, 1) - 1];
+    const float z = 1.959964f;
+    float z2 = z * z;
+    float v = (float)dof;
+    return z + z * (z2 + 1.0f) / (4.0f * v)
+             + z * ((5.0f * z2 + 16.0f) * z2 + 3.0f) / (96.0f * v * v)
+             + z * (((3.0f * z2 + 19.0f) * z2 + 17.0f) * z2 - 15.0f) / (384.0f * v * v * v);
+}
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdint.h>
+#include <type_traits>
+#include "eigen.cpp"
+#include "orthogonal_fit.h"
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+#include <functional>
+#include <thread>
+#endif
+
+// Polynomial fit by random sample consensus, for data with gross outliers
+// (mis-taps, sensor glitches) that would pull a least-squares fit away.
+//
+// Each hypothesis interpolates Degree + 1 randomly chosen points exactly,
+// with a fixed-size Vandermonde system per degree, and is scored over all
+// points with the truncated squared error (MSAC): inliers within the
+// threshold count their squared residual, everything else counts the
+// squared threshold. The number of hypotheses adapts to the best inlier
+// ratio seen so far, so clean data stops after a few dozen. The winning
+// hypothesis is then refined by a least-squares fit to its inliers.
+//
+// Hypotheses are drawn by two workers sharing one counter: the calling
+// task and a helper task, pinned to the core and run at the priority
+// setHelperTask() gives (a std::thread on the host). Without a helper the
+// calling task draws for both workers.
+template<int MaxDegree>
+class RansacPolynomialFit {
+public:
+    // Called every few hypotheses with the fraction of the (adaptive)
+    // hypothesis count drawn so far, from both workers at once; returning
+    // false ends the search, and the fit refines the best hypothesis yet
+    typedef bool (*ProgressCallback)(void* context, float fraction);
+    
+    RansacPolynomialFit()
+        : degree_(-1), count_(0), threshold_sq_(0.0f), center_(0.0f),
+          inv_half_width_(1.0f), hypotheses_(0), inlier_count_(0),
+          progress_(nullptr), progress_context_(nullptr), helper_core_(1),
+          helper_priority_(1) {
+        for (int w = 0; w < kWorkers; w++) {
+            workers_[w].rng = 0x9E3779B9u * (w + 1);
+        }
+#if defined(ESP_PLATFORM)
+        helper_task_ = nullptr;
+        helper_done_ = nullptr;
+#endif
+    }
+    
+    ~RansacPolynomialFit() {
+#if defined(ESP_PLATFORM)
+        if (helper_task_) vTaskDelete(helper_task_);
+        if (helper_done_) vSemaphoreDelete(helper_done_);
+#endif
+    }
+    
+    void setProgressCallback(ProgressCallback callback, void* context) {
+        progress_ = callback;
+        progress_context_ = context;
+    }
+    
+    // Core and FreeRTOS priority of the helper task, which is created on
+    // the next fit; a negative core runs without a helper. Call between
+    // fits only.
+    void setHelperTask(int core, int priority) {
+        helper_core_ = core;
+        helper_priority_ = priority;
+#if defined(ESP_PLATFORM)
+        if (helper_task_) {
+            vTaskDelete(helper_task_);
+            helper_task_ = nullptr;
+        }
+#endif
+    }
+    
+    // Fit a polynomial of the given degree (at most MaxDegree) to count
+    // points with members x and y. A point is an inlier when its residual
+    // is within threshold. The search stops once a hypothesis with all
+    // inliers has been drawn with the given confidence, or after
+    // max_hypotheses. Returns false if there are no points.
+    template<typename PointT>
+    bool fit(const PointT* points, int count, int degree, float threshold,
+             float confidence = 0.99f, int max_hypotheses = 2048) {
+        degree_ = -1;
+        count_ = count;
+        hypotheses_ = 0;
+        if (count < 1) return false;
+        degree = std::max(1, std::min(std::min(degree, MaxDegree), count - 1));
+        threshold_sq_ = threshold * threshold;
+        
+        // Solve in t in [-1, 1], which keeps the Vandermonde systems
+        // well conditioned whatever the data range
+        float min_x = points[0].x;
+        float max_x = points[0].x;
+        for (int i = 1; i < count; i++) {
+            min_x = std::min(min_x, points[i].x);
+            max_x = std::max(max_x, points[i].x);
+        }
+        float half_width = 0.5f * (max_x - min_x);
+        center_ = 0.5f * (min_x + max_x);
+        inv_half_width_ = half_width > 0.0f ? 1.0f / half_width : 1.0f;
+        
+        t_.resize(count);
+        y_.resize(count);
+        weights_.resize(count);
+        for (int i = 0; i < count; i++) {
+            t_(i) = (points[i].x - center_) * inv_half_width_;
+            y_(i) = points[i].y;
+        }
+        
+        // With no spare points every sample is the whole set
+        if (count > degree + 1) {
+            search_degree_ = degree;
+            log_failure_ = std::log(1.0f - confidence);
+            next_hypothesis_.store(0);
+            required_hypotheses_.store(max_hypotheses);
+            for (int w = 0; w < kWorkers; w++) {
+                workers_[w].best_cost = INFINITY;
+                workers_[w].hypotheses = 0;
+            }
+            runWorkers();
+        }
+        
+        // Best hypothesis over both workers; its inliers seed the refit
+        const Worker* best = nullptr;
+        for (int w = 0; w < kWorkers; w++) {
+            hypotheses_ += workers_[w].hypotheses;
+            if (count > degree + 1 && workers_[w].best_cost < INFINITY &&
+                (!best || workers_[w].best_cost < best->best_cost)) {
+                best = &workers_[w];
+            }
+        }
+        int inliers = count;
+        if (best) {
+            inliers = classify(best->coeffs, degree);
+        } else {
+            for (int i = 0; i < count; i++) weights_(i) = 1.0f;
+        }
+        
+        // Least-squares refinement on the inliers, then once more on the
+        // inliers of the refined curve if they changed
+        for (int pass = 0; pass < 2; pass++) {
+            if (inliers <= degree) {
+                for (int i = 0; i < count; i++) weights_(i) = 1.0f;
+                inliers = count;
+            }
+            engine_.fit(points, count, degree, weights_.data());
+            if (!best || pass == 1) break;
+            int changed = 0;
+            int refined_inliers = 0;
+            for (int i = 0; i < count; i++) {
+                float r = points[i].y - engine_(points[i].x);
+                float w = r * r <= threshold_sq_ ? 1.0f : 0.0f;
+                if (w != weights_(i)) changed++;
+                weights_(i) = w;
+                refined_inliers += (int)w;
+            }
+            inliers = refined_inliers;
+            if (changed == 0) break;
+        }
+        inlier_count_ = inliers;
+        degree_ = engine_.degree();
+        return true;
+    }
+    
+    int degree() const { return degree_; }
+    float operator()(float x) const { return engine_(x); }
+    
+    void evaluate(const float* x, float* y, int count) const {
+        engine_.evaluate(x, y, count);
+    }
+    
+    // The refined fit, weighted 1 on the inliers and 0 elsewhere
+    const OrthogonalPolynomialFit<MaxDegree>& weightedFit() const { return engine_; }
+    
+    // Inlier mask of the last fit as weights (1 inlier, 0 outlier)
+    const Eigen::VectorXf& weights() const { return weights_; }
+    bool isInlier(int i) const { return weights_(i) > 0.0f; }
+    int inlierCount() const { return inlier_count_; }
+    
+    // Hypotheses scored by the last fit, over both workers
+    int hypotheses() const { return hypotheses_; }
+    
+private:
+    static const int kWorkers = 2;
+    
+    // Hypotheses per worker between progress reports
+    static const int kProgressInterval = 32;
+    
+    // Samples with two points closer than this in t are degenerate
+    static constexpr float kMinSampleGap = 1e-3f;
+    
+#if defined(ESP_PLATFORM)
+    static const uint32_t kHelperStackSize = 4 * 1024;
+#endif
+    
+    // Per-worker state, padded so the two cores never share a cache line
+    struct Worker {
+        uint32_t rng;
+        int hypotheses;
+        float best_cost;
+        float coeffs[MaxDegree + 1];
+        char padding[64];
+    };
+    
+    // xorshift32, then a multiply-shift into [0, n)
+    static int randomIndex(uint32_t& state, int n) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (int)(((uint64_t)state * (uint32_t)n) >> 32);
+    }
+    
+    void runWorkers() {
+        if (helper_core_ < 0) {
+            search(workers_[0]);
+            search(workers_[1]);
+            return;
+        }
+#if defined(ESP_PLATFORM)
+        if (!helper_done_) helper_done_ = xSemaphoreCreateBinary();
+        if (helper_done_ && !helper_task_ &&
+            xTaskCreatePinnedToCore(helperTask, "ransac", kHelperStackSize, this,
+                                    (UBaseType_t)helper_priority_, &helper_task_,
+                                    (BaseType_t)helper_core_) != pdPASS) {
+            helper_task_ = nullptr;
+        }
+        if (helper_task_) {
+            xTaskNotifyGive(helper_task_);
+            search(workers_[0]);
+            xSemaphoreTake(helper_done_, portMAX_DELAY);
+        } else {
+            search(workers_[0]);
+            search(workers_[1]);
+        }
+#else
+        std::thread helper(&RansacPolynomialFit::search, this, std::ref(workers_[1]));
+        search(workers_[0]);
+        helper.join();
+#endif
+    }
+
+#if defined(ESP_PLATFORM)
+    // Helper task body: one search per notification, for the life of the fit
+    static void helperTask(void* arg) {
+        RansacPolynomialFit* self = (RansacPolynomialFit*)arg;
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            self->search(self->workers_[1]);
+            xSemaphoreGive(self->helper_done_);
+        }
+    }
+#endif
+    
+    void search(Worker& worker) {
+        searchDegree(worker, std::integral_constant<int, MaxDegree>());
+    }
+    
+    // Dispatch the runtime degree to the search specialized for it
+    template<int Degree>
+    void searchDegree(Worker& worker, std::integral_constant<int, Degree>) {
+        if (search_degree_ == Degree) {
+            searchFixed<Degree>(worker);
+        } else {
+            searchDegree(worker, std::integral_constant<int, Degree - 1>());
+        }
+    }
+    
+    void searchDegree(Worker&, std::integral_constant<int, 0>) {}
+    
+    template<int Degree>
+    void searchFixed(Worker& worker) {
+        const int kSample = Degree + 1;
+        const float* t = t_.data();
+        const float* y = y_.data();
+        int count = count_;
+        
+        while (next_hypothesis_.fetch_add(1, std::memory_order_relaxed) <
+               required_hypotheses_.load(std::memory_order_relaxed)) {
+            worker.hypotheses++;
+            if (progress_ && worker.hypotheses % kProgressInterval == 0) {
+                float drawn = (float)next_hypothesis_.load(std::memory_order_relaxed);
+                float required = (float)required_hypotheses_.load(std::memory_order_relaxed);
+                if (!progress_(progress_context_, std::min(drawn / required, 1.0f))) {
+                    required_hypotheses_.store(0);
+                    break;
+                }
+            }
+            
+            // Draw distinct indices with distinct enough abscissas
+            int sample[kSample];
+            bool degenerate = false;
+            for (int s = 0; s < kSample; s++) {
+                int index;
+                bool repeated;
+                do {
+                    index = randomIndex(worker.rng, count);
+                    repeated = false;
+                    for (int j = 0; j < s; j++) {
+                        repeated |= sample[j] == index;
+                    }
+                } while (repeated);
+                sample[s] = index;
+                for (int j = 0; j < s; j++) {
+                    degenerate |= std::fabs(t[sample[j]] - t[index]) < kMinSampleGap;
+                }
+            }
+            if (degenerate) continue;
+            
+            // Minimal solver: the polynomial through the sample
+            Eigen::Matrix<float, kSample, kSample> vandermonde;
+            Eigen::Vector<float, kSample> rhs;
+            EIGEN_UNROLL
+            for (int s = 0; s < kSample; s++) {
+                float ti = t[sample[s]];
+                float power = 1.0f;
+                EIGEN_UNROLL
+                for (int k = 0; k < kSample; k++) {
+                    vandermonde(s, k) = power;
+                    power *= ti;
+                }
+                rhs(s) = y[sample[s]];
+            }
+            Eigen::Vector<float, kSample> coeffs = vandermonde.partialPivLu().solve(rhs);
+            
+            // Truncated squared error, abandoned once it cannot win
+            float cost = 0.0f;
+            int inliers = 0;
+            int i = 0;
+            for (; i < count && cost < worker.best_cost; i++) {
+                float p = coeffs(Degree);
+                EIGEN_UNROLL
+                for (int k = Degree - 1; k >= 0; k--) {
+                    p = p * t[i] + coeffs(k);
+                }
+                float r = y[i] - p;
+                float r_sq = r * r;
+                if (r_sq <= threshold_sq_) {
+                    cost += r_sq;
+                    inliers++;
+                } else {
+                    cost += threshold_sq_;
+                }
+            }
+            if (i < count || cost >= worker.best_cost) continue;
+            
+            worker.best_cost = cost;
+            for (int k = 0; k < kSample; k++) {
+                worker.coeffs[k] = coeffs(k);
+            }
+            updateRequiredHypotheses(inliers, kSample);
+        }
+    }
+    
+    // Hypotheses needed to draw one all-inlier sample with the requested
+    // confidence, log(1 - p) / log(1 - w^s) for inlier ratio w, shared by
+    // both workers (the smallest bound wins)
+    void updateRequiredHypotheses(int inliers, int sample_size) {
+        float ratio = (float)inliers / count_;
+        float all_inliers = std::pow(ratio, (float)sample_size);
+        int required;
+        if (all_inliers >= 1.0f) {
+            required = 0;
+        } else {
+            float needed = std::ceil(log_failure_ / std::log1p(-all_inliers));
+            required = needed < (float)required_hypotheses_.load() ? (int)needed : INT32_MAX;
+        }
+        int current = required_hypotheses_.load();
+        while (required < current &&
+               !required_hypotheses_.compare_exchange_weak(current, required)) {
+        }
+    }
+    
+    // Weights 1 for the points a t-space hypothesis fits within the
+    // threshold, 0 elsewhere; returns the number of inliers
+    int classify(const float* coeffs, int degree) {
+        int inliers = 0;
+        for (int i = 0; i < count_; i++) {
+            float p = coeffs[degree];
+            for (int k = degree - 1; k >= 0; k--) {
+                p = p * t_(i) + coeffs[k];
+            }
+            float r = y_(i) - p;
+            float w = r * r <= threshold_sq_ ? 1.0f : 0.0f;
+            weights_(i) = w;
+            inliers += (int)w;
+        }
+        return inliers;
+    }
+    
+    int degree_;
+    int count_;
+    float threshold_sq_;
+    float center_;
+    float inv_half_width_;
+    int hypotheses_;
+    int inlier_count_;
+    
+    // Search parameters shared by the workers
+    int search_degree_;
+    float log_failure_;
+    std::atomic<int> next_hypothesis_;
+    std::atomic<int> required_hypotheses_;
+    Worker workers_[kWorkers];
+    ProgressCallback progress_;
+    void* progress_context_;
+    int helper_core_;
+    int helper_priority_;
+
+#if defined(ESP_PLATFORM)
+    TaskHandle_t helper_task_;
+    SemaphoreHandle_t helper_done_;
+#endif
+    
+    // Per-point workspace, kept between fits
+    Eigen::VectorXf t_;
+    Eigen::VectorXf y_;
+    Eigen::VectorXf weights_;
+    OrthogonalPolynomialFit<MaxDegree> engine_;
+};
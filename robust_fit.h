@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "eigen.cpp"
+#include "orthogonal_fit.h"
+
+// Weight functions for robust fitting, applied to residuals divided by a
+// robust estimate of the noise scale
+enum class RobustLoss {
+    Huber,   // w = min(1, k / |u|): outliers count linearly, never vanish
+    Tukey    // w = (1 - (u / c)^2)^2 inside |u| < c, 0 outside (bisquare)
+};
+
+// Polynomial fit that resists outliers, by iteratively reweighted least
+// squares on top of the orthogonal-basis engine.
+//
+// The ordinary least-squares fit is the starting point. Each iteration
+// estimates the noise scale from the median absolute residual, turns the
+// scaled residuals into weights and refits with them, until no residual
+// moves by more than a small fraction of the scale. All per-point buffers
+// are kept between iterations and between fits, so after the first fit
+// at a given point count the iterations allocate nothing.
+template<int MaxDegree>
+class RobustPolynomialFit {
+public:
+    // Called after every reweighted fit with the iteration number (from 1),
+    // the scale used for its weights and the largest residual change
+    typedef void (*IterationCallback)(void* context, int iteration,
+                                      float scale, float change);
+    
+    // Called after every reweighted fit with the fraction of the iteration
+    // limit used; returning false ends the fit there, as it stands
+    typedef bool (*ProgressCallback)(void* context, float fraction);
+    
+    RobustPolynomialFit()
+        : iterations_(0), converged_(false), scale_(0.0f), loss_(RobustLoss::Huber),
+          callback_(nullptr), callback_context_(nullptr),
+          progress_(nullptr), progress_context_(nullptr) {}
+    
+    void setIterationCallback(IterationCallback callback, void* context) {
+        callback_ = callback;
+        callback_context_ = context;
+    }
+    
+    void setProgressCallback(ProgressCallback callback, void* context) {
+        progress_ = callback;
+        progress_context_ = context;
+    }
+    
+    // Fit a polynomial of at most the given degree to count points with
+    // members x and y. Returns false if there are no points.
+    template<typename PointT>
+    bool fit(const PointT* points, int count, int degree, RobustLoss loss,
+             int max_iterations = 20, float tolerance = 1e-3f) {
+        iterations_ = 0;
+        converged_ = false;
+        loss_ = loss;
+        if (!engine_.fit(points, count, degree)) return false;
+        degree = engine_.degree();
+        
+        weights_.resize(count);
+        residual_.resize(count);
+        previous_residual_.resize(count);
+        abs_residual_.resize(count);
+        
+        // Scale below which residuals count as exact, relative to the data
+        float max_abs_y = 0.0f;
+        for (int i = 0; i < count; i++) {
+            max_abs_y = std::max(max_abs_y, std::fabs(points[i].y));
+        }
+        float min_scale = std::max(max_abs_y * kMinRelativeScale, 1e-30f);
+        
+        // The least-squares fit weighs every point alike
+        for (int i = 0; i < count; i++) {
+            weights_(i) = 1.0f;
+        }
+        
+        computeResiduals(points, count);
+        for (int iteration = 1; iteration <= max_iterations; iteration++) {
+            scale_ = std::max(medianAbsoluteResidual(count) * kMadToSigma, min_scale);
+            
+            // The new weights go into the buffer of the absolute residuals,
+            // which is free again, and replace weights_ only once the fit
+            // with them is done, so weights() always belongs to the fit.
+            // A weighted fit needs as many points with weight as
+            // coefficients.
+            int support = 0;
+            for (int i = 0; i < count; i++) {
+                float w = weight(residual_(i) / scale_, loss);
+                abs_residual_(i) = w;
+                if (w > 0.0f) support++;
+            }
+            if (support <= degree) break;
+            
+            engine_.fit(points, count, degree, abs_residual_.data());
+            std::swap(weights_, abs_residual_);
+            std::swap(residual_, previous_residual_);
+            computeResiduals(points, count);
+            
+            float change = 0.0f;
+            for (int i = 0; i < count; i++) {
+                change = std::max(change, std::fabs(residual_(i) - previous_residual_(i)));
+            }
+            iterations_ = iteration;
+            if (callback_) callback_(callback_context_, iteration, scale_, change);
+            if (change <= tolerance * scale_) {
+                converged_ = true;
+                break;
+            }
+            if (progress_ && !progress_(progress_context_, (float)iteration / max_iterations)) {
+                break;
+            }
+        }
+        return true;
+    }
+    
+    // The fit itself, with the weights of the last iteration applied
+    const OrthogonalPolynomialFit<MaxDegree>& weightedFit() const { return engine_; }
+    
+    int degree() const { return engine_.degree(); }
+    float operator()(float x) const { return engine_(x); }
+    
+    void evaluate(const float* x, float* y, int count) const {
+        engine_.evaluate(x, y, count);
+    }
+    
+    // Reweighted fits done by the last fit() (0 if least squares stood)
+    int iterations() const { return iterations_; }
+    bool converged() const { return converged_; }
+    
+    // Robust noise scale and final weight of each point; points with
+    // weight 0 were rejected as outliers (Tukey only)
+    float scale() const { return scale_; }
+    const Eigen::VectorXf& weights() const { return weights_; }
+    
+    // Weight the last fit's loss and scale give a residual, for points
+    // that were not part of the fit
+    float weight(float residual) const { return weight(residual / scale_, loss_); }
+    
+private:
+    // Tuning constants giving 95% efficiency on Gaussian noise
+    static constexpr float kHuberK = 1.345f;
+    static constexpr float kTukeyC = 4.685f;
+    
+    // Median absolute deviation of Gaussian noise, in standard deviations
+    static constexpr float kMadToSigma = 1.4826f;
+    
+    static constexpr float kMinRelativeScale = 1e-6f;
+    
+    static float weight(float u, RobustLoss loss) {
+        float a = std::fabs(u);
+        if (loss == RobustLoss::Huber) {
+            return a <= kHuberK ? 1.0f : kHuberK / a;
+        }
+        if (a >= kTukeyC) return 0.0f;
+        float v = u / kTukeyC;
+        float s = 1.0f - v * v;
+        return s * s;
+    }
+    
+    template<typename PointT>
+    void computeResiduals(const PointT* points, int count) {
+        for (int i = 0; i < count; i++) {
+            residual_(i) = points[i].y - engine_(points[i].x);
+        }
+    }
+    
+    float medianAbsoluteResidual(int count) {
+        float* a = abs_residual_.data();
+        for (int i = 0; i < count; i++) {
+            a[i] = std::fabs(residual_(i));
+        }
+        int mid = count / 2;
+        std::nth_element(a, a + mid, a + count);
+        float median = a[mid];
+        if (count % 2 == 0) {
+            median = 0.5f * (median + *std::max_element(a, a + mid));
+        }
+        return median;
+    }
+    
+    OrthogonalPolynomialFit<MaxDegree> engine_;
+    int iterations_;
+    bool converged_;
+    float scale_;
+    RobustLoss loss_;
+    IterationCallback callback_;
+    void* callback_context_;
+    ProgressCallback progress_;
+    void* progress_context_;
+    
+    // Per-point workspace, kept between iterations and fits
+    Eigen::VectorXf weights_;
+    Eigen::VectorXf residual_;
+    Eigen::VectorXf previous_residual_;
+    Eigen::VectorXf abs_residual_;
+};
@@ -0,0 +1,525 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "eigen.cpp"
+
+// Spline fitting engines for data a single polynomial cannot follow: a
+// cubic smoothing spline and a least-squares cubic B-spline with given
+// knots. Both reduce to a banded symmetric system, solved in O(n)
+// by the banded LDL^T factorization below, and evaluate one cubic segment
+// at a time, so their cost grows linearly with the number of points.
+
+// LDL^T factorization of a symmetric positive definite band matrix with
+// the given number of subdiagonals, in O(n * Bandwidth^2). Only the lower
+// band is stored, one row of Bandwidth + 1 entries per matrix row.
+template<typename T, int Bandwidth>
+class BandedLDLT {
+public:
+    BandedLDLT() : size_(0) {}
+    
+    // Resize to n x n and clear the band
+    void resize(int n) {
+        size_ = n;
+        band_.resize(n, Bandwidth + 1);
+        band_.setZero();
+    }
+    
+    int size() const { return size_; }
+    
+    // Element (i, j) of the lower band, i - Bandwidth <= j <= i
+    T& operator()(int i, int j) {
+        return band_(i, Bandwidth + j - i);
+    }
+    
+    T operator()(int i, int j) const {
+        return band_(i, Bandwidth + j - i);
+    }
+    
+    // Factorize in place: L below the diagonal, D on it. Pivots that
+    // rounding has driven to zero or below are clamped, so a nearly
+    // singular system still gives a finite solution.
+    void factorize() {
+        T max_diagonal = T(0);
+        for (int i = 0; i < size_; i++) {
+            max_diagonal = std::max(max_diagonal, (*this)(i, i));
+        }
+        T min_pivot = std::max(max_diagonal * std::numeric_limits<T>::epsilon(),
+                               std::numeric_limits<T>::min());
+        
+        for (int i = 0; i < size_; i++) {
+            int first = std::max(0, i - Bandwidth);
+            for (int j = first; j <= i; j++) {
+                T sum = (*this)(i, j);
+                for (int k = std::max(first, j - Bandwidth); k < j; k++) {
+                    sum -= (*this)(i, k) * (*this)(j, k) * (*this)(k, k);
+                }
+                if (j < i) {
+                    (*this)(i, j) = sum / (*this)(j, j);
+                } else {
+                    (*this)(i, i) = std::max(sum, min_pivot);
+                }
+            }
+        }
+    }
+    
+    // Solve A x = b in place after factorize()
+    void solve(T* b) const {
+        for (int i = 0; i < size_; i++) {
+            for (int k = std::max(0, i - Bandwidth); k < i; k++) {
+                b[i] -= (*this)(i, k) * b[k];
+            }
+        }
+        for (int i = 0; i < size_; i++) {
+            b[i] /= (*this)(i, i);
+        }
+        for (int i = size_ - 1; i >= 0; i--) {
+            for (int k = i + 1; k <= std::min(size_ - 1, i + Bandwidth); k++) {
+                b[i] -= (*this)(k, i) * b[k];
+            }
+        }
+    }
+    
+private:
+    int size_;
+    Eigen::Matrix<T> band_;
+};
+
+// Cubic smoothing spline: the function g minimizing
+//     sum w_i (y_i - g(x_i))^2 + lambda * integral g''(x)^2 dx,
+// a natural cubic spline with a knot at every distinct x. lambda = 0
+// interpolates; large lambda tends to the least-squares line. Fitted with
+// the Reinsch algorithm: the second derivatives at the interior knots
+// solve the pentadiagonal system (R + lambda Q^T W^-1 Q) gamma = Q^T y.
+// Points with the same x are merged into one weighted point.
+//
+// The condition number of that system grows like (range / smallest gap)^4,
+// which float cannot absorb once points sit close together, so it is
+// assembled and solved in double. The ESP32-S3 emulates double in
+// software, but the work is O(n) and evaluation stays in float.
+class SmoothingSpline {
+public:
+    SmoothingSpline() : knot_count_(0) {}
+    
+    // Fit count points with members x and y. Returns false if there are
+    // no points.
+    template<typename PointT>
+    bool fit(const PointT* points, int count, float lambda) {
+        knot_count_ = 0;
+        if (count < 1) return false;
+        
+        // Order by x and merge duplicates into weighted means
+        float min_x = points[0].x;
+        float max_x = points[0].x;
+        bool sorted = true;
+        for (int i = 1; i < count; i++) {
+            sorted = sorted && points[i].x >= points[i - 1].x;
+            min_x = std::min(min_x, points[i].x);
+            max_x = std::max(max_x, points[i].x);
+        }
+        float range = max_x - min_x;
+        float min_gap = range * kMinRelativeGap;
+        sortByX(points, count, sorted || !(range > 0.0f), min_x, range);
+        
+        // Evaluation reads the knots, values, spacing and second derivatives
+        // long after the fit, so they are kept on the heap, outside the
+        // arena the fit runs in. The resizes to the knot count below stay
+        // within these buffers.
+        {
+            Eigen::HeapScope result;
+            t_.resize(count);
+            g_.resize(count);
+            h_.resize(count);
+            gamma_.resize(count);
+        }
+        w_.resize(count);
+        int m = 0;
+        for (int i = 0; i < count; i++) {
+            const PointT& p = points[order_(i)];
+            if (m > 0 && p.x - t_(m - 1) <= min_gap) {
+                float w = w_(m - 1) + 1.0f;
+                g_(m - 1) += (p.y - g_(m - 1)) / w;
+                w_(m - 1) = w;
+            } else {
+                t_(m) = p.x;
+                g_(m) = p.y;
+                w_(m) = 1.0f;
+                m++;
+            }
+        }
+        knot_count_ = m;
+        gamma_.resize(m);
+        gamma_.setZero();
+        
+        // One or two knots: the constant or the line through them
+        if (m < 3) return true;
+        
+        h_.resize(m - 1);
+        for (int i = 0; i < m - 1; i++) {
+            h_(i) = t_(i + 1) - t_(i);
+        }
+        
+        // Interior knot j has unknown j - 1. Column j of Q holds
+        // 1/h[j-1], -(1/h[j-1] + 1/h[j]) and 1/h[j] in rows j-1, j, j+1.
+        int interior = m - 2;
+        system_.resize(interior);
+        solution_.resize(interior);
+        for (int j = 1; j <= interior; j++) {
+            double a = 1.0 / h_(j - 1);
+            double c = 1.0 / h_(j);
+            double b = -(a + c);
+            system_(j - 1, j - 1) = ((double)h_(j - 1) + h_(j)) / 3.0
+                + lambda * (a * a / w_(j - 1) + b * b / w_(j) + c * c / w_(j + 1));
+            if (j + 1 <= interior) {
+                double b1 = -(c + 1.0 / h_(j + 1));
+                system_(j, j - 1) = h_(j) / 6.0
+                    + lambda * (b * c / w_(j) + c * b1 / w_(j + 1));
+            }
+            if (j + 2 <= interior) {
+                system_(j + 1, j - 1) = lambda * c / h_(j + 1) / w_(j + 1);
+            }
+            solution_(j - 1) = a * g_(j - 1) + b * g_(j) + c * g_(j + 1);
+        }
+        system_.factorize();
+        system_.solve(solution_.data());
+        
+        // Fitted values g = y - lambda W^-1 Q gamma
+        for (int i = 0; i < m; i++) {
+            double gamma = i >= 1 && i <= interior ? solution_(i - 1) : 0.0;
+            double q_gamma = 0.0;
+            if (i + 1 <= interior) q_gamma += (solution_(i) - gamma) / h_(i);
+            else if (i + 1 < m) q_gamma -= gamma / h_(i);
+            if (i - 1 >= 1) q_gamma -= (gamma - solution_(i - 2)) / h_(i - 1);
+            else if (i > 0) q_gamma -= gamma / h_(i - 1);
+            g_(i) = (float)(g_(i) - lambda * q_gamma / w_(i));
+        }
+        for (int j = 1; j <= interior; j++) {
+            gamma_(j) = (float)solution_(j - 1);
+        }
+        return true;
+    }
+    
+    // Number of distinct x values, each a knot of the spline
+    int knotCount() const { return knot_count_; }
+    
+    float operator()(float x) const {
+        int segment = 0;
+        return value(x, segment);
+    }
+    
+    // y[i] = g(x[i]) for i = 0..count-1. Ascending x walks the segments
+    // in one pass.
+    void evaluate(const float* x, float* y, int count) const {
+        int segment = 0;
+        for (int i = 0; i < count; i++) {
+            y[i] = value(x[i], segment);
+        }
+    }
+    
+private:
+    // Duplicate x values closer than this fraction of the range are merged
+    static constexpr float kMinRelativeGap = 1e-6f;
+    
+    // Buckets larger than this are sorted by std::sort, not by insertion
+    static const int kInsertionSortLimit = 16;
+    
+    // Fill order_ with the point indices in ascending x, in expected O(n):
+    // a bucket sort over count equal spans of the range, then a sort of
+    // each bucket, which holds a few points unless the data clusters. An
+    // input already in order, or with a single x, is taken as it is.
+    template<typename PointT>
+    void sortByX(const PointT* points, int count, bool in_order, float min_x, float range) {
+        order_.resize(count);
+        if (in_order) {
+            for (int i = 0; i < count; i++) order_(i) = i;
+            return;
+        }
+        
+        // bucket_start_[b] is where bucket b begins in order_
+        bucket_start_.resize(count + 1);
+        bucket_start_.setZero();
+        float scale = count / range;
+        auto bucket = [&](int i) {
+            return std::min((int)((points[i].x - min_x) * scale), count - 1);
+        };
+        for (int i = 0; i < count; i++) bucket_start_(bucket(i) + 1)++;
+        for (int b = 0; b < count; b++) bucket_start_(b + 1) += bucket_start_(b);
+        for (int i = 0; i < count; i++) order_(bucket_start_(bucket(i))++) = i;
+        
+        // Placing the points advanced each start to the next bucket's
+        int* order = order_.data();
+        int begin = 0;
+        for (int b = 0; b < count; b++) {
+            int end = bucket_start_(b);
+            if (end - begin > kInsertionSortLimit) {
+                std::sort(order + begin, order + end, [points](int a, int c) {
+                    return points[a].x < points[c].x;
+                });
+            } else {
+                for (int i = begin + 1; i < end; i++) {
+                    int index = order[i];
+                    int j = i;
+                    for (; j > begin && points[order[j - 1]].x > points[index].x; j--) {
+                        order[j] = order[j - 1];
+                    }
+                    order[j] = index;
+                }
+            }
+            begin = end;
+        }
+    }
+    
+    // Value at x, starting the segment search from the given hint and
+    // leaving the segment found in it. The spline is linear beyond the
+    // outer knots.
+    float value(float x, int& segment) const {
+        int m = knot_count_;
+        if (m == 0) return 0.0f;
+        if (m == 1) return g_(0);
+        if (m == 2) {
+            return g_(0) + (x - t_(0)) * (g_(1) - g_(0)) / (t_(1) - t_(0));
+        }
+        if (x <= t_(0)) {
+            float slope = (g_(1) - g_(0)) / h_(0) - h_(0) * gamma_(1) / 6.0f;
+            return g_(0) + (x - t_(0)) * slope;
+        }
+        if (x >= t_(m - 1)) {
+            float slope = (g_(m - 1) - g_(m - 2)) / h_(m - 2) + h_(m - 2) * gamma_(m - 2) / 6.0f;
+            return g_(m - 1) + (x - t_(m - 1)) * slope;
+        }
+        
+        int i = std::min(std::max(segment, 0), m - 2);
+        if (x < t_(i) || x > t_(i + 1)) {
+            if (x > t_(i + 1) && x <= t_(std::min(i + 2, m - 1))) {
+                i++;
+            } else {
+                const float* knots = t_.data();
+                i = (int)(std::upper_bound(knots, knots + m, x) - knots) - 1;
+                i = std::min(std::max(i, 0), m - 2);
+            }
+        }
+        segment = i;
+        
+        float h = h_(i);
+        float left = x - t_(i);
+        float right = t_(i + 1) - x;
+        return (left * g_(i + 1) + right * g_(i)) / h
+            - left * right / 6.0f * ((1.0f + left / h) * gamma_(i + 1)
+                                     + (1.0f + right / h) * gamma_(i));
+    }
+    
+    int knot_count_;
+    
+    // Knots, fitted values, weights, knot spacing and second derivatives
+    // (zero at both ends), kept between fits
+    Eigen::VectorXf t_;
+    Eigen::VectorXf g_;
+    Eigen::VectorXf w_;
+    Eigen::VectorXf h_;
+    Eigen::VectorXf gamma_;
+    Eigen::Vector<double> solution_;
+    BandedLDLT<double, 2> system_;
+    
+    // Fit scratch: point indices in ascending x and the bucket offsets
+    // of the sort
+    Eigen::Vector<int> order_;
+    Eigen::Vector<int> bucket_start_;
+};
+
+// Least-squares cubic B-spline with caller-chosen or equally spaced
+// interior knots, clamped at the ends of the data range. Each point touches four basis
+// functions, so the normal equations are banded with three subdiagonals.
+// A very light penalty on second differences of the coefficients keeps
+// knot spans that hold no points from making the system singular.
+class BSplineFit {
+public:
+    BSplineFit() : basis_count_(0), knot_end_(0), span_scale_(0.0f) {}
+    
+    // Fit count points with members x and y, with knots at the ascending
+    // positions knots[0..knot_count-1]; knots outside the data range are
+    // ignored. Returns false if there are no points.
+    template<typename PointT>
+    bool fit(const PointT* points, int count, const float* knots, int knot_count) {
+        basis_count_ = 0;
+        float min_x, max_x;
+        if (!dataRange(points, count, min_x, max_x)) return false;
+        widenRange(min_x, max_x);
+        
+        // Clamped knot vector: each end repeated four times. Evaluation
+        // reads the knots and coefficients long after the fit, so they
+        // are kept on the heap, outside the arena the fit runs in.
+        {
+            Eigen::HeapScope result;
+            knots_.resize(std::max(knot_count, 0) + 8);
+        }
+        int k = 0;
+        for (int r = 0; r < 4; r++) knots_(k++) = min_x;
+        for (int i = 0; i < knot_count; i++) {
+            if (knots[i] > knots_(k - 1) && knots[i] < max_x) knots_(k++) = knots[i];
+        }
+        for (int r = 0; r < 4; r++) knots_(k++) = max_x;
+        knot_end_ = k;
+        span_scale_ = 0.0f;
+        return solve(points, count);
+    }
+    
+    // Fit with segments equal spans over the data range. The span of
+    // each point then follows from its x without a search.
+    template<typename PointT>
+    bool fitUniform(const PointT* points, int count, int segments) {
+        basis_count_ = 0;
+        float min_x, max_x;
+        if (!dataRange(points, count, min_x, max_x)) return false;
+        segments = std::max(segments, 1);
+        if (widenRange(min_x, max_x)) segments = 1;
+        
+        {
+            Eigen::HeapScope result;
+            knots_.resize(segments + 7);
+        }
+        int k = 0;
+        for (int r = 0; r < 4; r++) knots_(k++) = min_x;
+        for (int i = 1; i < segments; i++) {
+            knots_(k++) = min_x + (max_x - min_x) * i / segments;
+        }
+        for (int r = 0; r < 4; r++) knots_(k++) = max_x;
+        knot_end_ = k;
+        span_scale_ = segments / (max_x - min_x);
+        return solve(points, count);
+    }
+    
+    // Number of B-spline coefficients, interior knots + 4
+    int basisCount() const { return basis_count_; }
+    
+    float operator()(float x) const {
+        if (basis_count_ == 0) return 0.0f;
+        float b[4];
+        int span = findSpan(x);
+        basis(span, x, b);
+        const float* c = coeffs_.data() + span - 3;
+        return b[0] * c[0] + b[1] * c[1] + b[2] * c[2] + b[3] * c[3];
+    }
+    
+    // y[i] = s(x[i]) for i = 0..count-1. Beyond the data range the end
+    // segments are continued as cubics.
+    void evaluate(const float* x, float* y, int count) const {
+        for (int i = 0; i < count; i++) {
+            y[i] = (*this)(x[i]);
+        }
+    }
+    
+private:
+    static constexpr float kSmoothingPenalty = 1e-5f;
+    
+    // Smallest and largest x of count points; false if there are none
+    template<typename PointT>
+    static bool dataRange(const PointT* points, int count, float& min_x, float& max_x) {
+        if (count < 1) return false;
+        min_x = points[0].x;
+        max_x = points[0].x;
+        for (int i = 1; i < count; i++) {
+            min_x = std::min(min_x, points[i].x);
+            max_x = std::max(max_x, points[i].x);
+        }
+        return true;
+    }
+    
+    // A single x value gets a span wide enough not to round away; returns
+    // whether the range was widened
+    static bool widenRange(float min_x, float& max_x) {
+        if (max_x > min_x) return false;
+        max_x = min_x + std::max(1.0f, std::fabs(min_x));
+        return true;
+    }
+    
+    // Least-squares coefficients for the knots in knots_[0..knot_end_-1]
+    template<typename PointT>
+    bool solve(const PointT* points, int count) {
+        int basis_count = knot_end_ - 4;
+        {
+            Eigen::HeapScope result;
+            coeffs_.resize(basis_count);
+        }
+        
+        // Normal equations B^T B c = B^T y
+        system_.resize(basis_count);
+        coeffs_.setZero();
+        for (int i = 0; i < count; i++) {
+            float b[4];
+            int span = findSpan(points[i].x);
+            basis(span, points[i].x, b);
+            int first = span - 3;
+            for (int r = 0; r < 4; r++) {
+                for (int c = 0; c <= r; c++) {
+                    system_(first + r, first + c) += b[r] * b[c];
+                }
+                coeffs_(first + r) += b[r] * points[i].y;
+            }
+        }
+        
+        float mean_diagonal = 0.0f;
+        for (int j = 0; j < basis_count; j++) {
+            mean_diagonal += system_(j, j);
+        }
+        float penalty = mean_diagonal / basis_count * kSmoothingPenalty;
+        for (int j = 0; j + 2 < basis_count; j++) {
+            // Second difference c[j] - 2 c[j+1] + c[j+2]
+            const float d[3] = { 1.0f, -2.0f, 1.0f };
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c <= r; c++) {
+                    system_(j + r, j + c) += penalty * d[r] * d[c];
+                }
+            }
+        }
+        system_.factorize();
+        system_.solve(coeffs_.data());
+        basis_count_ = basis_count;
+        return true;
+    }
+    
+    // Index s of the knot span [knots[s], knots[s+1]) holding x, within
+    // the spans of the clamped knot vector. Equally spaced knots give the
+    // span from x directly, and the steps after it only undo rounding at
+    // a knot; other knots are searched.
+    int findSpan(float x) const {
+        const float* knots = knots_.data();
+        int first = 3;
+        int last = knot_end_ - 5;
+        if (span_scale_ == 0.0f) {
+            int span = (int)(std::upper_bound(knots + first, knots + last + 1, x) - knots) - 1;
+            return std::min(std::max(span, first), last);
+        }
+        float offset = (x - knots[first]) * span_scale_;
+        int span = offset < 0.0f ? first : first + (int)std::min(offset, (float)(last - first));
+        while (span > first && x < knots[span]) span--;
+        while (span < last && x >= knots[span + 1]) span++;
+        return span;
+    }
+    
+    // The four cubic basis functions nonzero on the span, by Cox-de Boor
+    void basis(int span, float x, float* b) const {
+        const float* knots = knots_.data();
+        float left[4];
+        float right[4];
+        b[0] = 1.0f;
+        for (int j = 1; j <= 3; j++) {
+            left[j] = x - knots[span + 1 - j];
+            right[j] = knots[span + j] - x;
+            float saved = 0.0f;
+            for (int r = 0; r < j; r++) {
+                float temp = b[r] / (right[r + 1] + left[j - r]);
+                b[r] = saved + right[r + 1] * temp;
+                saved = left[j - r] * temp;
+            }
+            b[j] = saved;
+        }
+    }
+    
+    int basis_count_;
+    int knot_end_;
+    float span_scale_;    // Spans per unit of x, or 0 for knots that are searched
+    Eigen::VectorXf knots_;
+    Eigen::VectorXf coeffs_;
+    BandedLDLT<float, 3> system_;
+};
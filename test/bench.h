@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Shared helpers of the host tests and benchmarks. The engines are
+// header-only and build on the host as they are; only the UI needs the
+// Arduino core.
+//
+// A test reports each failed check and returns nonzero from main(), which
+// is what ctest looks at. Timings are printed only. Every program runs a
+// quick set of sizes by default and the full set with --full.
+namespace bench {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+// Record a failure, with a printf-style message, unless condition holds
+#define BENCH_CHECK(condition, ...)                                      \
+    do {                                                                 \
+        if (!(condition)) {                                              \
+            bench::failures()++;                                         \
+            std::printf("FAIL %s:%d: ", __FILE__, __LINE__);             \
+            std::printf(__VA_ARGS__);                                    \
+            std::printf("\n");                                           \
+        }                                                                \
+    } while (0)
+
+// Whether --full was given
+inline bool fullRun(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--full") == 0) return true;
+    }
+    return false;
+}
+
+// Keep a result alive, so the optimizer cannot drop the work behind it
+template<typename T>
+inline void keep(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Median time of one call of fn, in microseconds. Calls are batched so
+// each timed run lasts at least about a millisecond.
+template<typename F>
+double timeMicros(F&& fn, int runs = 7) {
+    typedef std::chrono::steady_clock Clock;
+    int batch = 1;
+    for (;;) {
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < batch; i++) fn();
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        if (us >= 1000.0 || batch >= (1 << 20)) break;
+        batch *= 4;
+    }
+    std::vector<double> times(runs);
+    for (int r = 0; r < runs; r++) {
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < batch; i++) fn();
+        times[r] = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / batch;
+    }
+    std::nth_element(times.begin(), times.begin() + runs / 2, times.end());
+    return times[runs / 2];
+}
+
+// Seeded random numbers, so every run sees the same data
+class Random {
+public:
+    explicit Random(unsigned seed = 1) : engine_(seed) {}
+
+    float uniform(float low, float high) {
+        return std::uniform_real_distribution<float>(low, high)(engine_);
+    }
+
+    float normal(float sigma) {
+        return std::normal_distribution<float>(0.0f, sigma)(engine_);
+    }
+
+private:
+    std::mt19937 engine_;
+};
+
+// Point with the members the fitting engines read
+struct Point {
+    float x;
+    float y;
+};
+
+// count points with x uniform in [low, high] on the polynomial
+// coeffs[0..degree], plus Gaussian noise
+inline std::vector<Point> noisyPolynomial(Random& random, int count, float low, float high,
+                                          const float* coeffs, int degree, float noise) {
+    std::vector<Point> points(count);
+    for (Point& p : points) {
+        p.x = random.uniform(low, high);
+        float y = coeffs[degree];
+        for (int k = degree - 1; k >= 0; k--) y = y * p.x + coeffs[k];
+        p.y = y + random.normal(noise);
+    }
+    return points;
+}
+
+// 0 if every check passed, after saying so
+inline int finish() {
+    if (failures()) {
+        std::printf("%d check(s) failed\n", failures());
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,80 @@
+// Batch Horner evaluation against the pow() per term it replaced, for
+// curve sampling: time per batch and error against a double Horner.
+
+#include "bench.h"
+#include "polynomial_eval.h"
+
+namespace {
+
+// What the curve loop did before: one pow() per term, in double
+void evaluatePow(const float* coeffs, int degree, const float* x, float* y, int count) {
+    for (int i = 0; i < count; i++) {
+        float sum = 0.0f;
+        for (int k = 0; k <= degree; k++) {
+            sum += coeffs[k] * pow(x[i], k);
+        }
+        y[i] = sum;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {100, 10000};
+    if (bench::fullRun(argc, argv)) sizes.push_back(1000000);
+
+    const float coeffs[6] = {1.0f, -2.0f, 0.5f, 0.3f, -0.05f, 0.002f};
+    bench::Random random(5);
+
+    std::printf("%8s %6s %12s %12s %10s   %s\n", "n", "degree", "Horner us", "pow us",
+                "speedup", "max error");
+    for (int n : sizes) {
+        std::vector<float> x(n);
+        std::vector<float> horner(n);
+        std::vector<float> powered(n);
+        for (float& v : x) v = random.uniform(-10.0f, 10.0f);
+
+        for (int degree = 1; degree <= 5; degree += 2) {
+            evaluatePolynomial(coeffs, degree, x.data(), horner.data(), n);
+
+            // Error relative to the size of the terms, which is what float
+            // rounding scales with
+            double max_error = 0.0;
+            for (int i = 0; i < n; i++) {
+                double exact = coeffs[degree];
+                double magnitude = std::fabs(coeffs[degree]);
+                for (int k = degree - 1; k >= 0; k--) {
+                    exact = exact * x[i] + coeffs[k];
+                    magnitude = magnitude * std::fabs(x[i]) + std::fabs(coeffs[k]);
+                }
+                max_error = std::max(max_error, std::fabs(horner[i] - exact) / magnitude);
+            }
+            BENCH_CHECK(max_error < 1e-6, "n=%d degree=%d: relative error %g", n, degree,
+                        max_error);
+
+            // Single values and in-place batches agree with the batch
+            std::vector<float> in_place = x;
+            evaluatePolynomial(coeffs, degree, in_place.data(), in_place.data(), n);
+            for (int i = 0; i < n; i += std::max(n / 97, 1)) {
+                float single = evaluatePolynomial(coeffs, degree, x[i]);
+                BENCH_CHECK(std::fabs(single - horner[i]) <= 1e-5f * (1.0f + std::fabs(single)),
+                            "n=%d degree=%d: single %g vs batch %g at %d", n, degree,
+                            single, horner[i], i);
+                BENCH_CHECK(in_place[i] == horner[i], "n=%d degree=%d: in place differs at %d",
+                            n, degree, i);
+            }
+
+            double horner_us = bench::timeMicros([&] {
+                evaluatePolynomial(coeffs, degree, x.data(), horner.data(), n);
+                bench::keep(horner[0]);
+            });
+            double pow_us = bench::timeMicros([&] {
+                evaluatePow(coeffs, degree, x.data(), powered.data(), n);
+                bench::keep(powered[0]);
+            });
+            std::printf("%8d %6d %12.2f %12.2f %9.1fx   %.2e\n", n, degree, horner_us, pow_us,
+                        pow_us / horner_us, max_error);
+        }
+    }
+    return bench::finish();
+}
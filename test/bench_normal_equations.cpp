@@ -0,0 +1,142 @@
+// normalEquations(), the one-pass symmetric kernel for A^T A and A^T b,
+// against the general A^T B product with a second pass for A^T b, and
+// against the naive product of a materialized transpose: time and the
+// largest relative error against a double reference, for 6 and 21
+// columns and up to 1M rows (with --full). The gain is the kernel's over
+// the general product.
+
+#include "bench.h"
+#include "eigen.cpp"
+
+namespace {
+
+// The naive path: copy out A^T, then the triple loop over its rows and
+// the columns of A, which walks A with a stride of one row
+void naiveNormalEquations(const Eigen::MatrixXf& a, const Eigen::VectorXf& b,
+                          Eigen::MatrixXf& ata, Eigen::VectorXf& atb) {
+    int rows = a.rows(), cols = a.cols();
+    Eigen::MatrixXf at(cols, rows);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) at(c, r) = a(r, c);
+    }
+    ata.resize(cols, cols);
+    atb.resize(cols);
+    for (int i = 0; i < cols; i++) {
+        for (int j = 0; j < cols; j++) {
+            float sum = 0.0f;
+            for (int k = 0; k < rows; k++) sum += at(i, k) * a(k, j);
+            ata(i, j) = sum;
+        }
+        float sum = 0.0f;
+        for (int k = 0; k < rows; k++) sum += at(i, k) * b(k);
+        atb(i) = sum;
+    }
+}
+
+// Largest |x - reference| relative to the largest |reference| of its row,
+// so that entries that cancel to near zero do not dominate
+double maxRelativeError(const Eigen::MatrixXf& ata, const Eigen::VectorXf& atb,
+                        const std::vector<double>& reference, int cols) {
+    double worst = 0.0;
+    for (int i = 0; i < cols; i++) {
+        const double* row = &reference[i * (cols + 1)];
+        double scale = 0.0;
+        for (int j = 0; j <= cols; j++) scale = std::max(scale, std::fabs(row[j]));
+        for (int j = 0; j < cols; j++) {
+            worst = std::max(worst, std::fabs(ata(i, j) - row[j]) / scale);
+        }
+        worst = std::max(worst, std::fabs(atb(i) - row[cols]) / scale);
+    }
+    return worst;
+}
+
+void run(int rows, int cols, bench::Random& random, bool time_naive) {
+    // Monomials of x in [-1, 1], the rows of a polynomial fit
+    Eigen::MatrixXf a(rows, cols);
+    Eigen::VectorXf b(rows);
+    for (int r = 0; r < rows; r++) {
+        float x = random.uniform(-1.0f, 1.0f);
+        float power = 1.0f;
+        for (int c = 0; c < cols; c++) {
+            a(r, c) = power;
+            power *= x;
+        }
+        b(r) = std::sin(3.0f * x) + random.normal(0.1f);
+    }
+    std::vector<double> reference(cols * (cols + 1), 0.0);
+    for (int r = 0; r < rows; r++) {
+        for (int i = 0; i < cols; i++) {
+            double* row = &reference[i * (cols + 1)];
+            for (int j = 0; j < cols; j++) row[j] += (double)a(r, i) * a(r, j);
+            row[cols] += (double)a(r, i) * b(r);
+        }
+    }
+
+    Eigen::MatrixXf ata;
+    Eigen::VectorXf atb;
+    Eigen::VectorXf workspace;
+    normalEquations(a, b.data(), ata, atb, workspace);
+    double kernel_error = maxRelativeError(ata, atb, reference, cols);
+    for (int i = 0; i < cols; i++) {
+        for (int j = 0; j < i; j++) {
+            BENCH_CHECK(ata(i, j) == ata(j, i), "%d x %d: A^T A not symmetric at (%d, %d)",
+                        rows, cols, i, j);
+        }
+    }
+
+    // The general product, given a copy so it does not take the kernel
+    Eigen::MatrixXf copy = a;
+    Eigen::MatrixXf general_ata = a.transpose() * copy;
+    Eigen::VectorXf general_atb = a.transpose() * b;
+    double general_error = maxRelativeError(general_ata, general_atb, reference, cols);
+
+    Eigen::MatrixXf naive_ata;
+    Eigen::VectorXf naive_atb;
+    naiveNormalEquations(a, b, naive_ata, naive_atb);
+    double naive_error = maxRelativeError(naive_ata, naive_atb, reference, cols);
+
+    // The kernel sums in blocks of rows, so its error stays near float
+    // rounding whatever the row count
+    BENCH_CHECK(kernel_error < 1e-4, "%d x %d: kernel error %g", rows, cols, kernel_error);
+    BENCH_CHECK(kernel_error <= std::max(general_error, 1e-5),
+                "%d x %d: kernel error %g, general product %g", rows, cols, kernel_error,
+                general_error);
+
+    int runs = rows >= 1000000 ? 3 : 7;
+    double kernel_us = bench::timeMicros([&] {
+        normalEquations(a, b.data(), ata, atb, workspace);
+        bench::keep(ata(0, 0));
+    }, runs);
+    double general_us = bench::timeMicros([&] {
+        Eigen::MatrixXf product = a.transpose() * copy;
+        Eigen::VectorXf vector = a.transpose() * b;
+        bench::keep(product(0, 0));
+        bench::keep(vector(0));
+    }, runs);
+    double naive_us = NAN;
+    if (time_naive) {
+        naive_us = bench::timeMicros([&] {
+            naiveNormalEquations(a, b, naive_ata, naive_atb);
+            bench::keep(naive_ata(0, 0));
+        }, runs);
+    }
+    std::printf("%5d %8d %12.1f %12.1f %12.1f %6.1fx   %-9.2g %-9.2g %-9.2g\n", cols, rows,
+                kernel_us, general_us, naive_us, general_us / kernel_us, kernel_error,
+                general_error, naive_error);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool full = bench::fullRun(argc, argv);
+    std::vector<int> sizes = {100, 10000};
+    if (full) sizes.push_back(1000000);
+
+    std::printf("%5s %8s %12s %12s %12s %7s   %-9s %-9s %-9s\n", "cols", "rows",
+                "kernel us", "general us", "naive us", "gain", "kernel", "general", "naive");
+    bench::Random random(17);
+    for (int cols : {6, 21}) {
+        for (int rows : sizes) run(rows, cols, random, rows < 1000000 || cols < 21);
+    }
+    return bench::finish();
+}
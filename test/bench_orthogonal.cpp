@@ -0,0 +1,132 @@
+// Orthogonal-basis fit against monomial fits in float, degrees 1 to 20:
+// time and RMS residual, with a QR in double as the reference. The data
+// follows sin(x) on [0, 10], which needs the high degrees.
+
+#include "bench.h"
+#include "eigen.cpp"
+#include "orthogonal_fit.h"
+#include "polynomial_fit.h"
+
+namespace {
+
+const int kMaxDegree = 20;
+
+// Least squares of the given degree in double, by QR in the variable
+// t = (x - center) * inv_half_width in [-1, 1]; returns the RMS residual
+double referenceRms(const std::vector<bench::Point>& points, int degree) {
+    float min_x = points[0].x, max_x = points[0].x;
+    for (const bench::Point& p : points) {
+        min_x = std::min(min_x, p.x);
+        max_x = std::max(max_x, p.x);
+    }
+    double center = 0.5 * ((double)min_x + max_x);
+    double inv_half_width = 2.0 / ((double)max_x - min_x);
+    int n = (int)points.size();
+    Eigen::Matrix<double> a(n, degree + 1);
+    Eigen::Vector<double> y(n);
+    for (int i = 0; i < n; i++) {
+        double t = (points[i].x - center) * inv_half_width;
+        double power = 1.0;
+        for (int k = 0; k <= degree; k++) {
+            a(i, k) = power;
+            power *= t;
+        }
+        y(i) = points[i].y;
+    }
+    Eigen::Vector<double> c = a.householderQr().solve(y);
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        double fitted = 0.0;
+        for (int k = degree; k >= 0; k--) fitted = fitted * a(i, 1) + c(k);
+        sum += (y(i) - fitted) * (y(i) - fitted);
+    }
+    return std::sqrt(sum / n);
+}
+
+// The same in float in powers of x itself, as the monomial engine fits
+Eigen::VectorXf monomialQr(const std::vector<bench::Point>& points, int degree) {
+    int n = (int)points.size();
+    Eigen::MatrixXf a(n, degree + 1);
+    Eigen::VectorXf y(n);
+    for (int i = 0; i < n; i++) {
+        float power = 1.0f;
+        for (int k = 0; k <= degree; k++) {
+            a(i, k) = power;
+            power *= points[i].x;
+        }
+        y(i) = points[i].y;
+    }
+    return std::move(a).householderQr().solve(y);
+}
+
+template<typename F>
+double rms(const std::vector<bench::Point>& points, F&& fitted) {
+    double sum = 0.0;
+    for (const bench::Point& p : points) {
+        double r = p.y - (double)fitted(p.x);
+        sum += r * r;
+    }
+    return std::sqrt(sum / points.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int n = bench::fullRun(argc, argv) ? 100000 : 2000;
+    bench::Random random(11);
+    std::vector<bench::Point> points(n);
+    for (bench::Point& p : points) {
+        p.x = random.uniform(0.0f, 10.0f);
+        p.y = std::sin(p.x) + random.normal(0.05f);
+    }
+    PolynomialMoments<5> moments;
+    for (const bench::Point& p : points) moments.add(p.x, p.y);
+
+    std::printf("n = %d\n%6s %12s %12s   %-10s %-10s %-10s %-10s\n", n, "degree",
+                "orth us", "QR us", "orth rms", "QR rms", "moment rms", "double rms");
+    OrthogonalPolynomialFit<kMaxDegree> orthogonal;
+    for (int degree = 1; degree <= kMaxDegree; degree++) {
+        orthogonal.fit(points.data(), n, degree);
+        double orthogonal_rms = rms(points, [&](float x) { return orthogonal(x); });
+        Eigen::VectorXf qr = monomialQr(points, degree);
+        double qr_rms = rms(points, [&](float x) {
+            return evaluatePolynomial(qr.data(), degree, x);
+        });
+        double reference = referenceRms(points, degree);
+
+        // The moment solver only goes up to MAX_DEGREE
+        double moment_rms = NAN;
+        if (degree <= 5) {
+            Eigen::Vector<float, 6> c;
+            switch (degree) {
+                case 1: fitPolynomial<1>(moments, c, MomentSolver::LU, MomentPrecision::Mixed); break;
+                case 2: fitPolynomial<2>(moments, c, MomentSolver::LU, MomentPrecision::Mixed); break;
+                case 3: fitPolynomial<3>(moments, c, MomentSolver::LU, MomentPrecision::Mixed); break;
+                case 4: fitPolynomial<4>(moments, c, MomentSolver::LU, MomentPrecision::Mixed); break;
+                default: fitPolynomial<5>(moments, c, MomentSolver::LU, MomentPrecision::Mixed); break;
+            }
+            moment_rms = rms(points, [&](float x) {
+                return evaluatePolynomial(c.data(), degree, x);
+            });
+        }
+
+        double orthogonal_us = bench::timeMicros([&] {
+            orthogonal.fit(points.data(), n, degree);
+            bench::keep(orthogonal);
+        }, 5);
+        double qr_us = bench::timeMicros([&] {
+            Eigen::VectorXf c = monomialQr(points, degree);
+            bench::keep(c(0));
+        }, 5);
+        std::printf("%6d %12.1f %12.1f   %-10.6f %-10.6f %-10.6f %-10.6f\n", degree,
+                    orthogonal_us, qr_us, orthogonal_rms, qr_rms, moment_rms, reference);
+
+        // Float rounding of the fitted values alone is about 1e-7 of |y|
+        BENCH_CHECK(orthogonal.degree() == degree, "degree %d fitted as %d", degree,
+                    orthogonal.degree());
+        BENCH_CHECK(orthogonal_rms <= reference * (1.0 + 1e-3) + 1e-6,
+                    "degree %d: orthogonal rms %g vs reference %g", degree, orthogonal_rms,
+                    reference);
+    }
+    return bench::finish();
+}
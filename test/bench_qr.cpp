@@ -0,0 +1,109 @@
+// Householder QR against the normal equations solved by elimination, for
+// polynomial least squares in float: time and RMS residual, with a QR in
+// double as the reference. x is in [0, 10] and the degree 5, where the
+// normal equations lose most of float's precision.
+
+#include "bench.h"
+#include "eigen.cpp"
+
+namespace {
+
+const int kDegree = 5;
+
+template<typename T>
+Eigen::Matrix<T> vandermonde(const std::vector<bench::Point>& points) {
+    Eigen::Matrix<T> a((int)points.size(), kDegree + 1);
+    for (int i = 0; i < (int)points.size(); i++) {
+        T power = 1;
+        for (int k = 0; k <= kDegree; k++) {
+            a(i, k) = power;
+            power *= points[i].x;
+        }
+    }
+    return a;
+}
+
+template<typename T>
+Eigen::Vector<T> values(const std::vector<bench::Point>& points) {
+    Eigen::Vector<T> y((int)points.size());
+    for (int i = 0; i < (int)points.size(); i++) y(i) = points[i].y;
+    return y;
+}
+
+// RMS of y - p(x), accumulated in double
+template<typename T>
+double rmsResidual(const std::vector<bench::Point>& points, const Eigen::Vector<T>& c) {
+    double sum = 0.0;
+    for (const bench::Point& p : points) {
+        double y = (double)c(kDegree);
+        for (int k = kDegree - 1; k >= 0; k--) y = y * p.x + (double)c(k);
+        double r = p.y - y;
+        sum += r * r;
+    }
+    return std::sqrt(sum / points.size());
+}
+
+Eigen::VectorXf normalEquationsSolve(const Eigen::MatrixXf& a, const Eigen::VectorXf& y) {
+    Eigen::MatrixXf ata = a.transpose() * a;
+    Eigen::VectorXf aty = a.transpose() * y;
+    return ata.partialPivLu().solve(aty);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {100, 1000, 10000};
+    if (bench::fullRun(argc, argv)) sizes.push_back(100000);
+
+    const float coeffs[kDegree + 1] = {1.0f, -2.0f, 0.5f, 0.3f, -0.05f, 0.002f};
+    bench::Random random(7);
+
+    std::printf("%8s %12s %12s   %-10s %-10s %-10s\n", "n", "QR us", "normal us",
+                "QR rms", "normal rms", "double rms");
+    for (int n : sizes) {
+        std::vector<bench::Point> points =
+            bench::noisyPolynomial(random, n, 0.0f, 10.0f, coeffs, kDegree, 0.2f);
+        Eigen::MatrixXf a = vandermonde<float>(points);
+        Eigen::VectorXf y = values<float>(points);
+
+        Eigen::VectorXf qr_coeffs = a.householderQr().solve(y);
+        Eigen::VectorXf normal_coeffs = normalEquationsSolve(a, y);
+        Eigen::Vector<double> reference =
+            vandermonde<double>(points).householderQr().solve(values<double>(points));
+
+        double qr_rms = rmsResidual(points, qr_coeffs);
+        double normal_rms = rmsResidual(points, normal_coeffs);
+        double reference_rms = rmsResidual(points, reference);
+
+        double qr_us = bench::timeMicros([&] {
+            Eigen::VectorXf c = a.householderQr().solve(y);
+            bench::keep(c(0));
+        });
+        double normal_us = bench::timeMicros([&] {
+            Eigen::VectorXf c = normalEquationsSolve(a, y);
+            bench::keep(c(0));
+        });
+        std::printf("%8d %12.1f %12.1f   %-10.6f %-10.6f %-10.6f\n", n, qr_us, normal_us,
+                    qr_rms, normal_rms, reference_rms);
+
+        // Least squares cannot beat the reference; float QR should reach it
+        BENCH_CHECK(qr_rms <= reference_rms * (1.0 + 1e-4),
+                    "n=%d: QR rms %g vs reference %g", n, qr_rms, reference_rms);
+        BENCH_CHECK(qr_rms <= normal_rms * (1.0 + 1e-6),
+                    "n=%d: QR rms %g above the normal equations' %g", n, qr_rms, normal_rms);
+
+        // One factorization serves several right-hand sides
+        Eigen::MatrixXf::HouseholderQR qr = a.householderQr();
+        Eigen::VectorXf shifted = y;
+        for (int i = 0; i < n; i++) shifted(i) += 1.0f;
+        Eigen::VectorXf first = qr.solve(y);
+        Eigen::VectorXf second = qr.solve(shifted);
+        BENCH_CHECK(std::fabs(second(0) - first(0) - 1.0f) < 1e-2f,
+                    "n=%d: constant offset moved c0 by %g", n, second(0) - first(0));
+        for (int k = 1; k <= kDegree; k++) {
+            BENCH_CHECK(std::fabs(second(k) - first(k)) < 1e-2f * std::pow(10.0f, -k + 1),
+                        "n=%d: constant offset moved c%d", n, k);
+        }
+    }
+    return bench::finish();
+}
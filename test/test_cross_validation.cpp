@@ -0,0 +1,228 @@
+// The squared errors behind cross-validation and the bands, against the
+// same quantities computed from the points in double: squaredError() from
+// points, and kFoldError() against refitting each training set from its
+// points, also when both score only every k-th point as the UI does for a
+// large set. squaredError() from moments is printed alongside; beyond
+// [-1, 1] at degree 4-5 it is a small difference of huge terms and only
+// good to a few digits. The leverages behind the orthogonal fit's PRESS
+// are checked against the hat diagonal of a QR factorization, and the
+// standardization of the bands' covariance for x far from 0.
+
+#include "bench.h"
+#include "eigen.cpp"
+#include "orthogonal_fit.h"
+#include "polynomial_fit.h"
+
+namespace {
+
+const int kMaxDegree = 5;
+const int kFolds = 5;
+
+struct Range {
+    const char* name;
+    float low;
+    float high;
+    bool moment_rss;   // Whether squaredError() from moments holds there
+};
+
+// Least-squares polynomial of the given degree through the points of
+// every fold but skip (all of them for -1), by QR in double in the
+// variable t = x / scale; returns its coefficients in powers of x
+std::vector<double> fitDouble(const std::vector<bench::Point>& points, int degree, int skip,
+                              double scale) {
+    int n = 0;
+    for (int i = 0; i < (int)points.size(); i++) n += i % kFolds != skip;
+    Eigen::Matrix<double> a(n, degree + 1);
+    Eigen::Vector<double> y(n);
+    int row = 0;
+    for (int i = 0; i < (int)points.size(); i++) {
+        if (i % kFolds == skip) continue;
+        double t = points[i].x / scale;
+        double power = 1.0;
+        for (int k = 0; k <= degree; k++) {
+            a(row, k) = power;
+            power *= t;
+        }
+        y(row++) = points[i].y;
+    }
+    Eigen::Vector<double> c = a.householderQr().solve(y);
+    std::vector<double> coeffs(degree + 1);
+    for (int k = 0; k <= degree; k++) coeffs[k] = c(k) / std::pow(scale, k);
+    return coeffs;
+}
+
+// Sum of squared residuals over the points of one fold (all for -1),
+// of every stride-th point only
+template<typename T>
+double directSquaredError(const std::vector<bench::Point>& points, const T* c, int degree,
+                          int fold, int stride = 1) {
+    double sum = 0.0;
+    for (int i = 0; i < (int)points.size(); i += stride) {
+        if (fold >= 0 && i % kFolds != fold) continue;
+        double fitted = c[degree];
+        for (int k = degree - 1; k >= 0; k--) fitted = fitted * points[i].x + c[k];
+        double r = points[i].y - fitted;
+        sum += r * r;
+    }
+    return sum;
+}
+
+template<int Degree>
+void checkDegree(const Range& range, const std::vector<bench::Point>& points) {
+    // Folds by insertion order, as the UI keeps them
+    PolynomialMoments<kMaxDegree> folds[kFolds];
+    PolynomialMoments<kMaxDegree> total;
+    for (int i = 0; i < (int)points.size(); i++) {
+        folds[i % kFolds].add(points[i].x, points[i].y);
+        total.add(points[i].x, points[i].y);
+    }
+    int n = (int)points.size();
+
+    Eigen::Vector<float, kMaxDegree + 1> coeffs;
+    fitPolynomial<Degree>(total, coeffs, MomentSolver::LU, MomentPrecision::Mixed);
+    double exact_rss = directSquaredError(points, coeffs.data(), Degree, -1);
+    double point_rss = squaredError(points.data(), n, coeffs.data(), Degree);
+    double moment_rss = total.squaredError(coeffs.data(), Degree);
+    BENCH_CHECK(std::fabs(point_rss - exact_rss) <= 1e-4 * exact_rss,
+                "%s degree %d: squaredError over points %.7g vs %.7g", range.name, Degree,
+                point_rss, exact_rss);
+    if (range.moment_rss) {
+        BENCH_CHECK(std::fabs(moment_rss - exact_rss) <= 1e-4 * exact_rss,
+                    "%s degree %d: squaredError from moments %.7g vs %.7g", range.name,
+                    Degree, moment_rss, exact_rss);
+    }
+
+    // Held-out error of refits in double, against the moment folds. The
+    // float fits and their float evaluation cost a few 1e-4 at degree 5.
+    double scale = std::max(std::fabs(range.low), std::fabs(range.high));
+    std::vector<double> refits[kFolds];
+    double held_out = 0.0;
+    for (int f = 0; f < kFolds; f++) {
+        refits[f] = fitDouble(points, Degree, f, scale);
+        held_out += directSquaredError(points, refits[f].data(), Degree, f);
+    }
+    held_out /= n;
+    double k_fold = kFoldError<Degree>(folds, points.data(), n, MomentSolver::LU,
+                                       MomentPrecision::Mixed);
+    BENCH_CHECK(std::fabs(k_fold - held_out) <= 1e-3 * held_out,
+                "%s degree %d: kFoldError %.7g vs refits %.7g", range.name, Degree, k_fold,
+                held_out);
+
+    // On every stride-th point only, as the UI scores a large set, for
+    // strides that share no factor with the fold count. Over fewer points
+    // the float fits' error averages out less.
+    for (int stride : {3, 7}) {
+        std::vector<bench::Point> subset;
+        for (int i = 0; i < n; i += stride) subset.push_back(points[i]);
+        int m = (int)subset.size();
+        double strided_held_out = 0.0;
+        for (int f = 0; f < kFolds; f++) {
+            strided_held_out += directSquaredError(points, refits[f].data(), Degree, f, stride);
+        }
+        strided_held_out /= m;
+        double strided_k_fold = kFoldError<Degree>(folds, subset.data(), m, MomentSolver::LU,
+                                                   MomentPrecision::Mixed, stride);
+        BENCH_CHECK(std::fabs(strided_k_fold - strided_held_out) <= 2e-3 * strided_held_out,
+                    "%s degree %d: kFoldError every %dth point %.7g vs refits %.7g",
+                    range.name, Degree, stride, strided_k_fold, strided_held_out);
+    }
+    std::printf("%-8s %6d   %-12.7g %-12.7g %-12.7g   %-12.7g %-12.7g\n", range.name, Degree,
+                exact_rss, point_rss, moment_rss, k_fold, held_out);
+}
+
+// Leverages of the orthogonal fit against HouseholderQR::hatDiagonal() of
+// the monomial design matrix in the same variable t in [-1, 1]. Both are
+// the diagonal of the one projection, so they agree to float rounding and
+// sum to the number of terms.
+template<int Degree>
+void checkLeverage(const Range& range, const std::vector<bench::Point>& points) {
+    int n = (int)points.size();
+    OrthogonalPolynomialFit<Degree> orthogonal;
+    orthogonal.fit(points.data(), n, Degree);
+
+    float center = 0.5f * (range.low + range.high);
+    float half_width = 0.5f * (range.high - range.low);
+    Eigen::MatrixXf a(n, Degree + 1);
+    for (int i = 0; i < n; i++) {
+        float t = (points[i].x - center) / half_width;
+        float power = 1.0f;
+        for (int k = 0; k <= Degree; k++) {
+            a(i, k) = power;
+            power *= t;
+        }
+    }
+    Eigen::VectorXf hat;
+    a.householderQr().hatDiagonal(hat);
+
+    const Eigen::VectorXf& leverage = orthogonal.leverage();
+    float largest = 0.0f;
+    float worst = 0.0f;
+    double trace = 0.0;
+    for (int i = 0; i < n; i++) {
+        largest = std::max(largest, hat(i));
+        worst = std::max(worst, std::fabs(leverage(i) - hat(i)));
+        trace += hat(i);
+    }
+    BENCH_CHECK(worst <= 1e-3f * largest,
+                "%s degree %d: leverage differs from the QR hat diagonal by %g of %g",
+                range.name, Degree, worst, largest);
+    BENCH_CHECK(std::fabs(trace - (Degree + 1)) <= 1e-3 * (Degree + 1),
+                "%s degree %d: hat diagonal sums to %g", range.name, Degree, trace);
+}
+
+// The bands' covariance is kept in the standardized x. Its centre and
+// scale must hold for x far from 0, where E[x^2] and the squared mean
+// agree in more digits than a float has.
+void checkCovarianceScale(bench::Random& random, float low, float high) {
+    PolynomialMoments<kMaxDegree> moments;
+    std::vector<float> x(2000);
+    double mean = 0.0;
+    for (float& v : x) {
+        v = random.uniform(low, high);
+        moments.add(v, 1.0f);
+        mean += v;
+    }
+    mean /= x.size();
+    double spread = 0.0;
+    for (float v : x) spread += (v - mean) * (v - mean);
+    double deviation = std::sqrt(spread / x.size());
+
+    Eigen::Vector<float, kMaxDegree + 1> coeffs;
+    PolynomialCovariance<kMaxDegree> covariance;
+    fitPolynomial<2>(moments, coeffs, MomentSolver::LU, MomentPrecision::Mixed, &covariance);
+    double scale = 1.0 / covariance.inv_scale;
+    BENCH_CHECK(std::fabs(covariance.center - mean) <= 1e-3 * deviation &&
+                    std::fabs(scale - deviation) <= 1e-3 * deviation,
+                "[%g,%g]: covariance centre %.7g scale %.7g, data mean %.7g deviation %.7g",
+                low, high, covariance.center, scale, mean, deviation);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int n = bench::fullRun(argc, argv) ? 100000 : 2000;
+    const float coeffs[kMaxDegree + 1] = {1.0f, -2.0f, 0.5f, 0.3f, -0.05f, 0.002f};
+    const Range ranges[] = {
+        {"[-1,1]", -1.0f, 1.0f, true},
+        {"[0,10]", 0.0f, 10.0f, false},
+        {"[0,20]", 0.0f, 20.0f, false},
+    };
+
+    std::printf("n = %d\n%-8s %6s   %-12s %-12s %-12s   %-12s %-12s\n", n, "range", "degree",
+                "RSS", "points", "moments", "k-fold MSE", "refits");
+    for (const Range& range : ranges) {
+        bench::Random random(9);
+        std::vector<bench::Point> points = bench::noisyPolynomial(
+            random, n, range.low, range.high, coeffs, kMaxDegree, 0.2f);
+        checkDegree<1>(range, points);
+        checkDegree<2>(range, points);
+        checkDegree<3>(range, points);
+        checkDegree<4>(range, points);
+        checkDegree<5>(range, points);
+        checkLeverage<5>(range, points);
+    }
+    bench::Random random(11);
+    checkCovarianceScale(random, 1000.0f, 1010.0f);
+    checkCovarianceScale(random, 1000.0f, 1001.0f);
+    return bench::finish();
+}
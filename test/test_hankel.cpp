@@ -0,0 +1,176 @@
+// solveHankel() against the elimination (LU) solve of the same normal
+// equations and against a QR of the data, for degrees 1 to 5: RMS
+// residual in double and in float, and time per solve. Both solvers must
+// also stay finite when the data support a lower degree than asked for.
+
+#include "bench.h"
+#include "eigen.cpp"
+#include "polynomial_fit.h"
+
+namespace {
+
+const int kMaxDegree = 5;
+
+struct Case {
+    const char* name;
+    float low;
+    float high;
+};
+
+template<typename T>
+double rms(const std::vector<bench::Point>& points, const T* c, int degree) {
+    double sum = 0.0;
+    for (const bench::Point& p : points) {
+        double fitted = (double)c[degree];
+        for (int k = degree - 1; k >= 0; k--) fitted = fitted * p.x + (double)c[k];
+        sum += (p.y - fitted) * (p.y - fitted);
+    }
+    return std::sqrt(sum / points.size());
+}
+
+// Least squares of the given degree from the data itself, in double
+std::vector<double> qrReference(const std::vector<bench::Point>& points, int degree) {
+    int n = (int)points.size();
+    Eigen::Matrix<double> a(n, degree + 1);
+    Eigen::Vector<double> y(n);
+    for (int i = 0; i < n; i++) {
+        double power = 1.0;
+        for (int k = 0; k <= degree; k++) {
+            a(i, k) = power;
+            power *= points[i].x;
+        }
+        y(i) = points[i].y;
+    }
+    Eigen::Vector<double> c = a.householderQr().solve(y);
+    return std::vector<double>(c.data(), c.data() + degree + 1);
+}
+
+template<int Degree>
+void checkDegree(const Case& test, const std::vector<bench::Point>& points) {
+    PolynomialMoments<kMaxDegree> moments;
+    for (const bench::Point& p : points) moments.add(p.x, p.y);
+
+    // The same system for both solvers: in float from the float sums, and
+    // in double from the compensated sums, which are good to about twice
+    // float precision
+    Eigen::Matrix<float, Degree + 1, Degree + 1> ata;
+    Eigen::Vector<float, Degree + 1> aty;
+    moments.template normalEquations<Degree>(ata, aty);
+    Eigen::Matrix<double, Degree + 1, Degree + 1> ata_double;
+    Eigen::Vector<double, Degree + 1> aty_double;
+    moments.template normalEquations<Degree>(ata_double, aty_double, true);
+    float mu[2 * Degree + 1];
+    double mu_double[2 * Degree + 1];
+    for (int k = 0; k <= 2 * Degree; k++) {
+        mu[k] = moments.sumXk(k);
+        mu_double[k] = (double)moments.sumXk(k) + moments.sumXkError(k);
+    }
+
+    float hankel[Degree + 1];
+    solveHankel<Degree>(mu, aty.data(), hankel);
+    Eigen::Vector<float, Degree + 1> lu = ata.partialPivLu().solve(aty);
+    double hankel_double[Degree + 1];
+    solveHankel<Degree>(mu_double, aty_double.data(), hankel_double);
+    Eigen::Vector<double, Degree + 1> lu_double = ata_double.partialPivLu().solve(aty_double);
+    std::vector<double> reference = qrReference(points, Degree);
+
+    // In double both reach the least-squares fit of the data
+    double reference_rms = rms(points, reference.data(), Degree);
+    double hankel_double_rms = rms(points, hankel_double, Degree);
+    double lu_double_rms = rms(points, lu_double.data(), Degree);
+    BENCH_CHECK(std::fabs(hankel_double_rms / reference_rms - 1.0) < 1e-6,
+                "%s degree %d: Hankel rms %.9g vs reference %.9g in double", test.name,
+                Degree, hankel_double_rms, reference_rms);
+    BENCH_CHECK(std::fabs(lu_double_rms / reference_rms - 1.0) < 1e-6,
+                "%s degree %d: LU rms %.9g vs reference %.9g in double", test.name,
+                Degree, lu_double_rms, reference_rms);
+
+    // In float the residuals are what matters: neither solver may lose
+    // much more of the fit than the other
+    double hankel_rms = rms(points, hankel, Degree);
+    double lu_rms = rms(points, lu.data(), Degree);
+    double hankel_excess = hankel_rms / reference_rms - 1.0;
+    double lu_excess = lu_rms / reference_rms - 1.0;
+    BENCH_CHECK(hankel_excess <= std::max(4.0 * lu_excess, 1e-4),
+                "%s degree %d: Hankel rms %g, LU %g, reference %g", test.name, Degree,
+                hankel_rms, lu_rms, reference_rms);
+
+    // Solver as fitPolynomial() selects it, per solve of the moments
+    Eigen::Vector<float, kMaxDegree + 1> coeffs;
+    double hankel_ns = 1e3 * bench::timeMicros([&] {
+        fitPolynomial<Degree>(moments, coeffs, MomentSolver::Hankel, MomentPrecision::Float);
+        bench::keep(coeffs(0));
+    });
+    double lu_ns = 1e3 * bench::timeMicros([&] {
+        fitPolynomial<Degree>(moments, coeffs, MomentSolver::LU, MomentPrecision::Float);
+        bench::keep(coeffs(0));
+    });
+    std::printf("%-8s %6d %10.0f %10.0f   %-10.6f %-10.6f %-10.6f\n", test.name, Degree,
+                hankel_ns, lu_ns, hankel_rms, lu_rms, reference_rms);
+}
+
+template<int Degree>
+void checkDegenerate() {
+    // Three distinct x values support at most a quadratic: the solver
+    // stops there and leaves the higher coefficients at zero
+    PolynomialMoments<kMaxDegree> moments;
+    const float x[3] = {1.0f, 2.0f, 4.0f};
+    for (int r = 0; r < 4; r++) {
+        for (float v : x) moments.add(v, 1.0f + v * v);
+    }
+    float mu[2 * Degree + 1];
+    float rhs[Degree + 1];
+    for (int k = 0; k <= 2 * Degree; k++) mu[k] = moments.sumXk(k);
+    for (int k = 0; k <= Degree; k++) rhs[k] = moments.sumXkY(k);
+    float c[Degree + 1];
+    solveHankel<Degree>(mu, rhs, c);
+    for (int k = 0; k <= Degree; k++) {
+        BENCH_CHECK(std::isfinite(c[k]), "degenerate degree %d: c%d = %g", Degree, k, c[k]);
+    }
+    for (float v : x) {
+        float fitted = evaluatePolynomial(c, Degree, v);
+        BENCH_CHECK(std::fabs(fitted - (1.0f + v * v)) < 1e-2f,
+                    "degenerate degree %d: p(%g) = %g", Degree, v, fitted);
+    }
+
+    // The LU treats pivots that are rounding error as zero, so it stops
+    // at the quadratic as well
+    Eigen::Vector<float, kMaxDegree + 1> lu;
+    fitPolynomial<Degree>(moments, lu, MomentSolver::LU, MomentPrecision::Float);
+    for (int k = 0; k <= Degree; k++) {
+        BENCH_CHECK(std::isfinite(lu(k)) && (k <= 2 || std::fabs(lu(k)) < 1e-3f),
+                    "degenerate degree %d: LU c%d = %g", Degree, k, lu(k));
+    }
+    for (float v : x) {
+        float fitted = evaluatePolynomial(lu.data(), Degree, v);
+        BENCH_CHECK(std::fabs(fitted - (1.0f + v * v)) < 1e-2f,
+                    "degenerate degree %d: LU p(%g) = %g", Degree, v, fitted);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int n = bench::fullRun(argc, argv) ? 100000 : 1000;
+    const float coeffs[kMaxDegree + 1] = {1.0f, -2.0f, 0.5f, 0.3f, -0.05f, 0.002f};
+    const Case cases[] = {
+        {"[-1,1]", -1.0f, 1.0f},
+        {"[0,10]", 0.0f, 10.0f},
+    };
+
+    std::printf("n = %d\n%-8s %6s %10s %10s   %-10s %-10s %-10s\n", n, "range", "degree",
+                "Hankel ns", "LU ns", "Hankel rms", "LU rms", "QR rms");
+    for (const Case& test : cases) {
+        bench::Random random(3);
+        std::vector<bench::Point> points = bench::noisyPolynomial(
+            random, n, test.low, test.high, coeffs, kMaxDegree, 0.2f);
+        checkDegree<1>(test, points);
+        checkDegree<2>(test, points);
+        checkDegree<3>(test, points);
+        checkDegree<4>(test, points);
+        checkDegree<5>(test, points);
+    }
+    checkDegenerate<3>();
+    checkDegenerate<5>();
+    return bench::finish();
+}
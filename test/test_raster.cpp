@@ -0,0 +1,326 @@
+// CanvasRaster against a per-pixel reference: discs (stamped and not),
+// thick lines at many angles, polylines and bands, clipped and not, must
+// give the same pixels as computing every pixel's coverage from its
+// distance to the shape. The coverage of each shape is also checked
+// against its area, and the time per frame of the plot's dots and curve
+// is printed for both.
+
+#include "bench.h"
+#include "canvas_raster.h"
+
+namespace {
+
+const int kWidth = 600;
+const int kHeight = 400;
+const uint16_t kBackground = 0x18E3;
+
+struct Clip {
+    int x0, y0, x1, y1;
+};
+
+// Alpha in 0..32 of a pixel at distance from a capsule of the radius, as
+// the raster rounds it
+uint32_t coverageAlpha(float distance, float radius) {
+    float coverage = radius + 0.5f - distance;
+    if (coverage <= 0.0f) return 0;
+    return coverage >= 1.0f ? 32 : (uint32_t)(coverage * 32.0f + 0.5f);
+}
+
+float segmentDistance(float x, float y, float ax, float ay, float bx, float by) {
+    float dx = bx - ax, dy = by - ay;
+    float length_sq = dx * dx + dy * dy;
+    float t = length_sq > 0.0f ? ((x - ax) * dx + (y - ay) * dy) / length_sq : 0.0f;
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    return std::hypot(x - ax - t * dx, y - ay - t * dy);
+}
+
+// The reference: every pixel of the clip rectangle blended by its own
+// coverage, with no spans, stamps or bounds
+void referenceCapsule(std::vector<uint16_t>& pixels, const Clip& clip, float ax, float ay,
+                      float bx, float by, float radius, uint16_t color) {
+    for (int y = clip.y0; y <= clip.y1; y++) {
+        for (int x = clip.x0; x <= clip.x1; x++) {
+            uint32_t alpha = coverageAlpha(segmentDistance(x, y, ax, ay, bx, by), radius);
+            uint16_t& pixel = pixels[y * kWidth + x];
+            if (alpha) pixel = alpha >= 32 ? color : CanvasRaster::blend(pixel, color, alpha);
+        }
+    }
+}
+
+// How many pixels differ, and the largest difference of any channel in
+// its own units
+struct Diff {
+    int max_channel;
+    int pixels;
+};
+
+Diff compare(const std::vector<uint16_t>& a, const std::vector<uint16_t>& b) {
+    Diff diff = {0, 0};
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] == b[i]) continue;
+        diff.pixels++;
+        int red = std::abs((a[i] >> 11) - (b[i] >> 11));
+        int green = std::abs(((a[i] >> 5) & 63) - ((b[i] >> 5) & 63));
+        int blue = std::abs((a[i] & 31) - (b[i] & 31));
+        diff.max_channel = std::max(diff.max_channel, std::max(red, std::max(green, blue)));
+    }
+    return diff;
+}
+
+// One shape drawn by the raster and by the reference over the same
+// background, which must agree pixel for pixel, and nothing drawn outside
+// the clip rectangle
+template<typename Draw>
+void checkShape(const char* name, const Clip& clip, Draw&& draw, float ax, float ay, float bx,
+                float by, float radius) {
+    const uint16_t color = 0xFD20;
+    std::vector<uint16_t> drawn(kWidth * kHeight, kBackground);
+    std::vector<uint16_t> expected(kWidth * kHeight, kBackground);
+    CanvasRaster raster;
+    raster.setBuffer(drawn.data(), kWidth, kHeight);
+    raster.setClip(clip.x0, clip.y0, clip.x1, clip.y1);
+    draw(raster, color);
+    Clip bounded = {std::max(clip.x0, 0), std::max(clip.y0, 0), std::min(clip.x1, kWidth - 1),
+                    std::min(clip.y1, kHeight - 1)};
+    referenceCapsule(expected, bounded, ax, ay, bx, by, radius, color);
+
+    Diff diff = compare(drawn, expected);
+    BENCH_CHECK(diff.pixels == 0, "%s: %d pixels differ, by up to %d", name, diff.pixels,
+                diff.max_channel);
+    for (int y = 0; y < kHeight; y++) {
+        for (int x = 0; x < kWidth; x++) {
+            bool inside = x >= bounded.x0 && x <= bounded.x1 && y >= bounded.y0 && y <= bounded.y1;
+            if (!inside && drawn[y * kWidth + x] != kBackground) {
+                BENCH_CHECK(false, "%s: pixel (%d, %d) outside the clip drawn", name, x, y);
+                return;
+            }
+        }
+    }
+}
+
+// Summed coverage of a shape drawn in white on black, in pixels, from the
+// green channel
+double ink(const std::vector<uint16_t>& pixels) {
+    double sum = 0.0;
+    for (uint16_t p : pixels) sum += ((p >> 5) & 63) / 63.0;
+    return sum;
+}
+
+// The coverage falls off over one pixel across the edge, which is exact
+// for straight edges; a round end adds pi / 12 over its area
+void checkArea(const char* name, float length, float radius, const std::vector<uint16_t>& pixels) {
+    const double pi = 3.14159265358979;
+    double area = pi * radius * radius + 2.0 * radius * length + pi / 12.0;
+    double measured = ink(pixels);
+    BENCH_CHECK(std::fabs(measured - area) <= 0.02 * area + 1.0, "%s: coverage %g, area %g",
+                name, measured, area);
+}
+
+void checkDiscs(bench::Random& random) {
+    const Clip whole = {0, 0, kWidth - 1, kHeight - 1};
+    const Clip window = {100, 80, 140, 120};
+    char name[64];
+    for (float radius : {0.5f, 1.0f, 2.5f, 4.0f, 7.75f, 8.0f, 8.5f, 13.0f, 40.0f}) {
+        for (int trial = 0; trial < 6; trial++) {
+            // Inside, across the buffer's edges, and across a clip window
+            float cx = random.uniform(50.0f, 550.0f);
+            float cy = random.uniform(50.0f, 350.0f);
+            const Clip* clip = &whole;
+            if (trial == 1) cx = random.uniform(-radius, radius);
+            if (trial == 2) cy = kHeight - 1 + random.uniform(-radius, radius);
+            if (trial >= 3) {
+                clip = &window;
+                cx = random.uniform(95.0f, 145.0f);
+                cy = random.uniform(75.0f, 125.0f);
+            }
+            std::snprintf(name, sizeof(name), "disc r=%g at (%.2f, %.2f)", radius, cx, cy);
+            checkShape(name, *clip, [&](CanvasRaster& raster, uint16_t color) {
+                raster.fillDisc(cx, cy, radius, color);
+            }, cx, cy, cx, cy, radius);
+        }
+    }
+
+    // The stamp is reused for equal dots at equal offsets within a pixel
+    std::vector<uint16_t> twice(kWidth * kHeight, kBackground);
+    std::vector<uint16_t> expected(kWidth * kHeight, kBackground);
+    CanvasRaster raster;
+    raster.setBuffer(twice.data(), kWidth, kHeight);
+    raster.fillDisc(100.25f, 100.75f, 3.0f, 0xFFFF);
+    raster.fillDisc(300.25f, 200.75f, 3.0f, 0xFFFF);
+    referenceCapsule(expected, whole, 100.25f, 100.75f, 100.25f, 100.75f, 3.0f, 0xFFFF);
+    referenceCapsule(expected, whole, 300.25f, 200.75f, 300.25f, 200.75f, 3.0f, 0xFFFF);
+    Diff diff = compare(twice, expected);
+    BENCH_CHECK(diff.pixels == 0, "repeated disc: %d pixels differ", diff.pixels);
+
+    for (float radius : {1.0f, 3.0f, 8.0f, 20.0f}) {
+        std::vector<uint16_t> black(kWidth * kHeight, 0);
+        raster.setBuffer(black.data(), kWidth, kHeight);
+        raster.fillDisc(300.4f, 200.6f, radius, 0xFFFF);
+        std::snprintf(name, sizeof(name), "disc area r=%g", radius);
+        checkArea(name, 0.0f, radius, black);
+    }
+}
+
+void checkLines(bench::Random& random) {
+    const Clip whole = {0, 0, kWidth - 1, kHeight - 1};
+    const Clip window = {200, 150, 260, 230};
+    char name[80];
+    for (float width : {1.0f, 2.0f, 2.5f, 6.0f}) {
+        // Horizontal, vertical and diagonal, then random angles and lengths
+        const float fixed[4][4] = {
+            {100.3f, 200.5f, 500.8f, 200.5f}, {300.5f, 50.2f, 300.5f, 350.7f},
+            {100.0f, 100.0f, 300.0f, 300.0f}, {250.0f, 190.0f, 250.0f, 190.0f},
+        };
+        for (int trial = 0; trial < 14; trial++) {
+            float ax, ay, bx, by;
+            if (trial < 4) {
+                ax = fixed[trial][0];
+                ay = fixed[trial][1];
+                bx = fixed[trial][2];
+                by = fixed[trial][3];
+            } else {
+                ax = random.uniform(-50.0f, 650.0f);
+                ay = random.uniform(-50.0f, 450.0f);
+                float length = random.uniform(0.2f, trial % 2 ? 8.0f : 400.0f);
+                float angle = random.uniform(0.0f, 6.2832f);
+                bx = ax + length * std::cos(angle);
+                by = ay + length * std::sin(angle);
+            }
+            const Clip& clip = trial >= 10 ? window : whole;
+            std::snprintf(name, sizeof(name), "line w=%g (%.1f, %.1f)-(%.1f, %.1f)%s", width, ax,
+                          ay, bx, by, &clip == &window ? " clipped" : "");
+            checkShape(name, clip, [&](CanvasRaster& raster, uint16_t color) {
+                raster.drawLine(ax, ay, bx, by, width, color);
+            }, ax, ay, bx, by, 0.5f * width);
+        }
+    }
+
+    for (float width : {1.0f, 2.0f, 5.0f}) {
+        std::vector<uint16_t> black(kWidth * kHeight, 0);
+        CanvasRaster raster;
+        raster.setBuffer(black.data(), kWidth, kHeight);
+        raster.drawLine(120.3f, 80.6f, 470.1f, 310.2f, width, 0xFFFF);
+        std::snprintf(name, sizeof(name), "line area w=%g", width);
+        checkArea(name, std::hypot(470.1f - 120.3f, 310.2f - 80.6f), 0.5f * width, black);
+    }
+}
+
+// A polyline is its segments drawn one after the other
+void checkPolyline(bench::Random& random) {
+    std::vector<bench::Point> points(40);
+    for (int i = 0; i < (int)points.size(); i++) {
+        points[i].x = 20.0f + 14.0f * i;
+        points[i].y = 200.0f + 150.0f * std::sin(0.3f * i) + random.uniform(-5.0f, 5.0f);
+    }
+    std::vector<uint16_t> drawn(kWidth * kHeight, kBackground);
+    std::vector<uint16_t> expected(kWidth * kHeight, kBackground);
+    CanvasRaster raster;
+    raster.setBuffer(drawn.data(), kWidth, kHeight);
+    raster.drawPolyline(points.data(), (int)points.size(), 2.0f, 0x07E0);
+    const Clip whole = {0, 0, kWidth - 1, kHeight - 1};
+    for (int i = 0; i + 1 < (int)points.size(); i++) {
+        referenceCapsule(expected, whole, points[i].x, points[i].y, points[i + 1].x,
+                         points[i + 1].y, 1.0f, 0x07E0);
+    }
+    Diff diff = compare(drawn, expected);
+    BENCH_CHECK(diff.pixels == 0, "polyline: %d pixels differ, by up to %d", diff.pixels,
+                diff.max_channel);
+}
+
+// Bands blend each pixel between top and bottom once
+void checkBand(bench::Random& random) {
+    const int left = -20;
+    const int count = kWidth + 40;
+    std::vector<int16_t> top(count), bottom(count);
+    for (int c = 0; c < count; c++) {
+        float middle = 200.0f + 180.0f * std::sin(0.02f * c);
+        float half = 10.0f + 40.0f * random.uniform(0.0f, 1.0f);
+        top[c] = (int16_t)(middle - half);
+        bottom[c] = (int16_t)(middle + half);
+        if (c % 97 == 0) std::swap(top[c], bottom[c]);   // An empty column
+    }
+    const Clip clips[2] = {{0, 0, kWidth - 1, kHeight - 1}, {150, 100, 420, 260}};
+    for (const Clip& clip : clips) {
+        for (uint32_t alpha : {4u, 32u}) {
+            std::vector<uint16_t> drawn(kWidth * kHeight, kBackground);
+            std::vector<uint16_t> expected(kWidth * kHeight, kBackground);
+            CanvasRaster raster;
+            raster.setBuffer(drawn.data(), kWidth, kHeight);
+            raster.setClip(clip.x0, clip.y0, clip.x1, clip.y1);
+            raster.fillBand(left, top.data(), bottom.data(), count, 0x041F, alpha);
+            for (int c = 0; c < count; c++) {
+                int x = left + c;
+                if (x < clip.x0 || x > clip.x1) continue;
+                for (int y = std::max((int)top[c], clip.y0); y <= std::min((int)bottom[c], clip.y1);
+                     y++) {
+                    uint16_t& pixel = expected[y * kWidth + x];
+                    pixel = alpha >= 32 ? 0x041F : CanvasRaster::blend(pixel, 0x041F, alpha);
+                }
+            }
+            Diff diff = compare(drawn, expected);
+            BENCH_CHECK(diff.pixels == 0, "band alpha %u clip (%d, %d): %d pixels differ",
+                        alpha, clip.x0, clip.y0, diff.pixels);
+        }
+    }
+}
+
+// A plot's worth: DOT_POINT_LIMIT dots and a curve across the canvas,
+// drawn by the raster and by the per-pixel reference within each shape's
+// bounding box
+void timeFrame(bench::Random& random) {
+    const int dots = 2000;
+    const float radius = 2.5f;
+    std::vector<bench::Point> centers(dots);
+    for (bench::Point& p : centers) {
+        p.x = (float)(int)random.uniform(0.0f, kWidth);
+        p.y = (float)(int)random.uniform(0.0f, kHeight);
+    }
+    std::vector<bench::Point> curve(kWidth / 2);
+    for (int i = 0; i < (int)curve.size(); i++) {
+        curve[i].x = 2.0f * i;
+        curve[i].y = 200.0f + 150.0f * std::sin(0.01f * i) * std::cos(0.037f * i);
+    }
+
+    std::vector<uint16_t> pixels(kWidth * kHeight, kBackground);
+    CanvasRaster raster;
+    raster.setBuffer(pixels.data(), kWidth, kHeight);
+    double raster_us = bench::timeMicros([&] {
+        for (const bench::Point& p : centers) raster.fillDisc(p.x, p.y, radius, 0xF800);
+        raster.drawPolyline(curve.data(), (int)curve.size(), 2.0f, 0x07E0);
+        bench::keep(pixels[0]);
+    });
+    double reference_us = bench::timeMicros([&] {
+        for (const bench::Point& p : centers) {
+            Clip box = {std::max(0, (int)(p.x - radius - 1)), std::max(0, (int)(p.y - radius - 1)),
+                        std::min(kWidth - 1, (int)(p.x + radius + 1)),
+                        std::min(kHeight - 1, (int)(p.y + radius + 1))};
+            referenceCapsule(pixels, box, p.x, p.y, p.x, p.y, radius, 0xF800);
+        }
+        for (int i = 0; i + 1 < (int)curve.size(); i++) {
+            const bench::Point& a = curve[i];
+            const bench::Point& b = curve[i + 1];
+            Clip box = {std::max(0, (int)(std::min(a.x, b.x) - 2)),
+                        std::max(0, (int)(std::min(a.y, b.y) - 2)),
+                        std::min(kWidth - 1, (int)(std::max(a.x, b.x) + 2)),
+                        std::min(kHeight - 1, (int)(std::max(a.y, b.y) + 2))};
+            referenceCapsule(pixels, box, a.x, a.y, b.x, b.y, 1.0f, 0x07E0);
+        }
+        bench::keep(pixels[0]);
+    });
+    std::printf("%d dots r=%g and a %d-point curve: raster %.1f us, per-pixel %.1f us\n", dots,
+                radius, (int)curve.size(), raster_us, reference_us);
+}
+
+} // namespace
+
+int main(int, char**) {
+    bench::Random random(21);
+    BENCH_CHECK(CanvasRaster::blend(0x1234, 0xFEDC, 32) == 0xFEDC, "blend at full alpha");
+    BENCH_CHECK(CanvasRaster::blend(0x1234, 0xFEDC, 0) == 0x1234, "blend at zero alpha");
+    checkDiscs(random);
+    checkLines(random);
+    checkPolyline(random);
+    checkBand(random);
+    timeFrame(random);
+    return bench::finish();
+}
@@ -0,0 +1,74 @@
+// The robust fit's weights against the fit they belong to: however the
+// iterations end, weights() must be the weights of weightedFit(), since
+// the UI derives the outliers it draws from them.
+
+#include "bench.h"
+#include "robust_fit.h"
+
+namespace {
+
+// Sum of the weights and the weighted fit's own, which must agree
+void checkConsistent(const char* name, const RobustPolynomialFit<5>& fit, int count) {
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) sum += fit.weights()(i);
+    float engine_sum = fit.weightedFit().weightSum();
+    BENCH_CHECK(std::fabs(sum - engine_sum) <= 1e-4f * std::max(engine_sum, 1.0f),
+                "%s: weights sum to %g, the fit used %g", name, sum, engine_sum);
+    std::printf("%-24s %2d iterations, weight sum %g\n", name, fit.iterations(), sum);
+}
+
+} // namespace
+
+int main(int, char**) {
+    RobustPolynomialFit<5> fit;
+    bench::Random random(13);
+
+    // Noisy line with a few gross outliers: the usual, converging case
+    for (RobustLoss loss : {RobustLoss::Huber, RobustLoss::Tukey}) {
+        const float line[2] = {1.0f, 0.5f};
+        std::vector<bench::Point> points = bench::noisyPolynomial(random, 200, 0.0f, 10.0f,
+                                                                  line, 1, 0.1f);
+        for (int i = 0; i < 200; i += 25) points[i].y += 20.0f;
+        fit.fit(points.data(), (int)points.size(), 1, loss);
+        checkConsistent(loss == RobustLoss::Huber ? "Huber, outliers" : "Tukey, outliers",
+                        fit, (int)points.size());
+        BENCH_CHECK(fit.converged(), "no convergence with outliers");
+        BENCH_CHECK(std::fabs(fit(5.0f) - 3.5f) < 0.1f, "fit misses the line: %g", fit(5.0f));
+
+        // Once converged, weight() gives the points their own weights back,
+        // as the UI uses it for points left out of a large fit
+        float worst = 0.0f;
+        for (int i = 0; i < (int)points.size(); i++) {
+            float weight = fit.weight(points[i].y - fit(points[i].x));
+            worst = std::max(worst, std::fabs(weight - fit.weights()(i)));
+        }
+        BENCH_CHECK(worst < 1e-2f, "weight() differs from the fit's weights by %g", worst);
+    }
+
+    // Seven points for a quartic, three far off. After a few reweighted
+    // fits Tukey leaves fewer points with weight than coefficients, which
+    // ends the iterations with the weights computed for a fit never made.
+    const bench::Point few[7] = {
+        {9.51135635f, -52.4327583f}, {2.83801818f, 0.00185176893f},
+        {3.39416718f, -0.00159814104f}, {9.74403477f, -68.6744385f},
+        {6.68796587f, 8.96157837f}, {7.74477243f, 0.0f}, {3.25809956f, -0.000474586966f},
+    };
+    fit.fit(few, 7, 4, RobustLoss::Tukey);
+    checkConsistent("Tukey, support too small", fit, 7);
+    BENCH_CHECK(!fit.converged() && fit.iterations() < 20,
+                "the iterations did not stop on support (%d)", fit.iterations());
+
+    // A progress callback that stops after the first reweighted fit
+    std::vector<bench::Point> points(300);
+    for (bench::Point& p : points) {
+        p.x = random.uniform(-1.0f, 1.0f);
+        bool outlier = random.uniform(0.0f, 1.0f) < 0.2f;
+        p.y = p.x * p.x + random.normal(0.05f) + (outlier ? 3.0f : 0.0f);
+    }
+    fit.setProgressCallback([](void*, float) { return false; }, nullptr);
+    fit.fit(points.data(), (int)points.size(), 2, RobustLoss::Tukey);
+    checkConsistent("Tukey, stopped early", fit, (int)points.size());
+    BENCH_CHECK(fit.iterations() == 1, "%d reweighted fits after stopping",
+                fit.iterations());
+    return bench::finish();
+}
@@ -0,0 +1,169 @@
+// The spline engines: the smoothing spline interpolates at lambda = 0
+// whatever order the points come in, the B-spline reproduces a cubic
+// spline on the uneven knots it is given and agrees with its equal-span
+// fast path, and both engines evaluate the same after the arena their fit
+// ran in has been rewound and reused, as the UI tessellates a fit again
+// on every pan.
+
+#include "bench.h"
+#include "spline_fit.h"
+
+namespace {
+
+// Points on sin(x) with noise, one in each of count equal cells of
+// [0, 10] so no two are merged, in random order
+std::vector<bench::Point> wave(bench::Random& random, int count) {
+    std::vector<bench::Point> points(count);
+    for (int i = 0; i < count; i++) {
+        points[i].x = (i + random.uniform(0.1f, 0.9f)) * 10.0f / count;
+        points[i].y = std::sin(points[i].x) + random.normal(0.1f);
+    }
+    for (int i = count - 1; i > 0; i--) {
+        std::swap(points[i], points[std::min((int)random.uniform(0.0f, i + 1.0f), i)]);
+    }
+    return points;
+}
+
+// Values of the fit at count evenly spaced x across and beyond the data
+template<typename Fit>
+std::vector<float> sample(const Fit& fit, int count) {
+    std::vector<float> x(count), y(count);
+    for (int i = 0; i < count; i++) x[i] = -1.0f + 12.0f * i / (count - 1);
+    fit.evaluate(x.data(), y.data(), count);
+    return y;
+}
+
+// Fit within an arena, rewind it and fill it with other buffers, then
+// evaluate again
+template<typename Fit, typename FitFn>
+void checkOutlivesArena(const char* name, Fit& fit, FitFn&& fitFn) {
+    Eigen::Arena arena(1 << 20);
+    std::vector<float> before;
+    {
+        Eigen::ArenaScope scope(arena);
+        fitFn(fit);
+        before = sample(fit, 500);
+    }
+    {
+        Eigen::ArenaScope scope(arena);
+        Eigen::VectorXf clobber(arena.capacity() / sizeof(float) - 64);
+        for (int i = 0; i < clobber.size(); i++) clobber(i) = NAN;
+        bench::keep(clobber(0));
+    }
+    std::vector<float> after = sample(fit, 500);
+    int changed = 0;
+    for (int i = 0; i < (int)before.size(); i++) changed += !(after[i] == before[i]);
+    BENCH_CHECK(changed == 0, "%s: %d of %d values changed after the arena was reused", name,
+                changed, (int)before.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int n = bench::fullRun(argc, argv) ? 200000 : 5000;
+    bench::Random random(23);
+    std::vector<bench::Point> points = wave(random, n);
+
+    // At lambda = 0 the spline passes through every point
+    SmoothingSpline spline;
+    spline.fit(points.data(), n, 0.0f);
+    BENCH_CHECK(spline.knotCount() == n, "%d knots for %d points", spline.knotCount(), n);
+    float worst = 0.0f;
+    for (const bench::Point& p : points) worst = std::max(worst, std::fabs(spline(p.x) - p.y));
+    BENCH_CHECK(worst < 1e-3f, "interpolating spline misses a point by %g", worst);
+
+    // Shuffled, sorted and reversed input give the same spline, also when
+    // the points cluster and close ones are merged
+    std::vector<bench::Point> clustered = points;
+    for (bench::Point& p : clustered) p.x = std::pow(p.x, 6.0f);
+    for (std::vector<bench::Point>* input : {&points, &clustered}) {
+        const char* name = input == &points ? "spread" : "clustered";
+        std::vector<bench::Point> ordered = *input;
+        std::sort(ordered.begin(), ordered.end(),
+                  [](const bench::Point& a, const bench::Point& b) { return a.x < b.x; });
+        SmoothingSpline shuffled, sorted, reversed;
+        shuffled.fit(input->data(), n, 0.5f);
+        sorted.fit(ordered.data(), n, 0.5f);
+        std::reverse(ordered.begin(), ordered.end());
+        reversed.fit(ordered.data(), n, 0.5f);
+        std::vector<float> a = sample(shuffled, 1000), b = sample(sorted, 1000),
+                           c = sample(reversed, 1000);
+        int differ = 0;
+        for (int i = 0; i < 1000; i++) differ += !(a[i] == b[i] && a[i] == c[i]);
+        BENCH_CHECK(differ == 0, "%s: input order changes %d of 1000 values", name, differ);
+        BENCH_CHECK(shuffled.knotCount() == sorted.knotCount(), "%s: %d knots vs %d", name,
+                    shuffled.knotCount(), sorted.knotCount());
+    }
+
+    // A cubic spline with knots at 0.5, 1, 3 and 7.5 is in the span of the
+    // B-splines on those knots, so their fit reproduces it up to float
+    // rounding and the bias of the light penalty. Equal spans miss its
+    // kinks.
+    const float knots[] = {0.5f, 1.0f, 3.0f, 7.5f};
+    const float jumps[] = {0.5f, -1.0f, 1.0f, -0.5f};
+    auto kinked = [&](float x) {
+        float y = 0.2f * x - 0.05f * x * x;
+        for (int k = 0; k < 4; k++) y += jumps[k] * std::pow(std::max(x - knots[k], 0.0f), 3.0f);
+        return y;
+    };
+    std::vector<bench::Point> kinked_points = points;
+    for (bench::Point& p : kinked_points) p.y = kinked(p.x);
+    BSplineFit on_knots, on_spans;
+    on_knots.fit(kinked_points.data(), n, knots, 4);
+    on_spans.fitUniform(kinked_points.data(), n, 5);
+    BENCH_CHECK(on_knots.basisCount() == 8, "%d B-splines on 4 knots", on_knots.basisCount());
+    float largest = 0.0f;
+    float knots_worst = 0.0f;
+    float spans_worst = 0.0f;
+    for (const bench::Point& p : kinked_points) {
+        largest = std::max(largest, std::fabs(p.y));
+        knots_worst = std::max(knots_worst, std::fabs(on_knots(p.x) - p.y));
+        spans_worst = std::max(spans_worst, std::fabs(on_spans(p.x) - p.y));
+    }
+    BENCH_CHECK(knots_worst < 1e-3f * largest, "B-spline on the knots misses the spline by %g",
+                knots_worst);
+    BENCH_CHECK(spans_worst > 20.0f * knots_worst,
+                "B-spline on equal spans misses by %g, on the knots by %g", spans_worst,
+                knots_worst);
+
+    // The same knots given explicitly take the searched spans, and must
+    // give the fit the equal-span path computes its spans for
+    const int segments = 12;
+    std::vector<float> uniform_knots;
+    for (int i = 1; i < segments; i++) uniform_knots.push_back(10.0f * i / segments);
+    BSplineFit searched, computed;
+    float min_x = points[0].x, max_x = points[0].x;
+    for (const bench::Point& p : points) {
+        min_x = std::min(min_x, p.x);
+        max_x = std::max(max_x, p.x);
+    }
+    for (float& knot : uniform_knots) knot = min_x + (max_x - min_x) * (knot / 10.0f);
+    searched.fit(points.data(), n, uniform_knots.data(), segments - 1);
+    computed.fitUniform(points.data(), n, segments);
+    std::vector<float> a = sample(searched, 1000), b = sample(computed, 1000);
+    float paths_worst = 0.0f;
+    for (int i = 0; i < 1000; i++) paths_worst = std::max(paths_worst, std::fabs(a[i] - b[i]));
+    BENCH_CHECK(paths_worst < 1e-4f, "searched and computed spans differ by %g", paths_worst);
+
+    checkOutlivesArena("smoothing spline", spline, [&](SmoothingSpline& fit) {
+        fit.fit(points.data(), n, 0.5f);
+    });
+    BSplineFit bspline;
+    checkOutlivesArena("B-spline", bspline, [&](BSplineFit& fit) {
+        fit.fitUniform(points.data(), n, 12);
+    });
+    checkOutlivesArena("B-spline on knots", bspline, [&](BSplineFit& fit) {
+        fit.fit(kinked_points.data(), n, knots, 4);
+    });
+
+    double setup_us = bench::timeMicros([&] {
+        spline.fit(points.data(), n, 0.5f);
+        bench::keep(spline);
+    }, 5);
+    double bspline_us = bench::timeMicros([&] {
+        bspline.fitUniform(points.data(), n, 12);
+        bench::keep(bspline);
+    }, 5);
+    std::printf("n = %d: smoothing spline %.1f us, B-spline %.1f us\n", n, setup_us, bspline_us);
+    return bench::finish();
+}